@@ -61,7 +61,17 @@ HEADERS += ./include/stdafx.h\
            ./include/elementadvupwind.h \
            ./include/elementadvcentral.h \
            ./include/elementadvhybrid.h \
-           ./include/elementadvtvd.h
+           ./include/elementadvtvd.h \
+           ./include/elementstatestore.h \
+           ./include/elementfluxkernels.h \
+           ./include/transportoperator.h \
+           ./include/transportjacobian.h \
+           ./include/implicittransportsolver.h \
+           ./include/treelinearsolver.h \
+           ./include/reachblockpreconditioner.h \
+           ./include/subnetworkscheduler.h \
+           ./include/firsttouchallocator.h \
+           ./include/modelarena.h
 
 SOURCES +=./src/stdafx.cpp \
           ./src/cshcomponent.cpp \
@@ -83,7 +93,16 @@ SOURCES +=./src/stdafx.cpp \
           ./src/elementadvupwind.cpp \
           ./src/elementadvcentral.cpp \
           ./src/elementadvhybrid.cpp \
-          ./src/elementadvtvd.cpp
+          ./src/elementadvtvd.cpp \
+          ./src/elementstatestore.cpp \
+          ./src/elementfluxkernels.cpp \
+          ./src/transportoperator.cpp \
+          ./src/transportjacobian.cpp \
+          ./src/implicittransportsolver.cpp \
+          ./src/treelinearsolver.cpp \
+          ./src/reachblockpreconditioner.cpp \
+          ./src/subnetworkscheduler.cpp \
+          ./src/modelarena.cpp
 
 
 macx{
@@ -33,6 +33,15 @@
 #include <unordered_map>
 #include "threadsafenetcdf/threadsafencvar.h"
 #include "elementadvtvd.h"
+#include "elementstatestore.h"
+#include "elementfluxkernels.h"
+#include "transportoperator.h"
+#include "transportjacobian.h"
+#include "implicittransportsolver.h"
+#include "treelinearsolver.h"
+#include "reachblockpreconditioner.h"
+#include "subnetworkscheduler.h"
+#include "modelarena.h"
 
 #ifdef USE_NETCDF
 #include <netcdf>
@@ -68,8 +77,12 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
     friend class SourceBC;
     friend class HydraulicsBC;
     friend class MeteorologyBC;
+    friend class ElementAdvUpwind;
+    friend class ElementAdvCentral;
+    friend class ElementAdvHybrid;
     friend class ElementAdvTVD;
     friend class ElementAdvQUICK;
+    friend class CSHComponentTest;
 
   public:
 
@@ -211,22 +224,23 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
     ODESolver *odeSolver() const;
 
     /*!
-     * \brief computeDerivedHydraulics
+     * \brief computeDerivedHydraulics - Computes the derived hydraulics of the elements and junctions outside the
+     * fused element sweep of update.
      */
     void computeDerivedHydraulics();
 
     /*!
-     * \brief computeEvaporation
+     * \brief computeEvaporation - Computes the evaporation heat flux of the elements outside the fused element sweep of update.
      */
     void computeEvaporation();
 
     /*!
-     * \brief computeConvection
+     * \brief computeConvection - Computes the convection heat flux of the elements outside the fused element sweep of update.
      */
     void computeConvection();
 
     /*!
-     * \brief computeFluidFrictionHeat
+     * \brief computeFluidFrictionHeat - Computes the fluid friction heat of the elements outside the fused element sweep of update.
      */
     void computeFluidFrictionHeat();
 
@@ -514,6 +528,17 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
 
   private:
 
+    /*!
+     * \brief The ParallelPhase enum - Parallel regions whose number of threads is tuned at startup.
+     */
+    enum ParallelPhase
+    {
+      ElementPhases, //Element phases of update(), the heat and solute balances and the time step
+      RightHandSidePhase, //Right hand side evaluations
+      SolverValuesPhase, //Copies between the elements and the solver vectors
+      NumParallelPhases
+    };
+
     /*!
      * \brief initializeInputFiles
      * \param errors
@@ -535,6 +560,19 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
      */
     bool initializeElements(std::list<std::string> &errors);
 
+    /*!
+     * \brief reorderElements - Restores the input order of the elements and junctions or, when element reordering is on,
+     * renumbers them along the drainage tree so that neighbouring elements and junctions are adjacent in memory and in the
+     * solver vector. Output and the indexed accessors keep the input order.
+     */
+    void reorderElements();
+
+    /*!
+     * \brief buildJunctionAdjacency - Copies the incoming and outgoing elements of each junction into one contiguous array in
+     * element order and points ElementJunction::incoming and ElementJunction::outgoing at their parts of it.
+     */
+    void buildJunctionAdjacency();
+
     /*!
      * \brief initializeSolver
      * \param errors
@@ -575,6 +613,58 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
      */
     void prepareForNextTimeStep();
 
+    /*!
+     * \brief bindThreads - Binds each OpenMP thread to one processor of the process so that the memory the thread first
+     * touches stays on its memory node. Does nothing when the OpenMP runtime already binds its threads.
+     */
+    void bindThreads();
+
+    /*!
+     * \brief initializeThreadTuning - Starts tuning the number of threads of each parallel phase unless a model of the same
+     * size has already been tuned in this process. All phases use the default number of threads when thread tuning is off.
+     */
+    void initializeThreadTuning();
+
+    /*!
+     * \brief threadTuningClock
+     * \return Wall clock time in seconds while tuning and zero otherwise.
+     */
+    double threadTuningClock() const;
+
+    /*!
+     * \brief recordPhaseTime - Records the time a phase took with the current candidate number of threads while tuning.
+     * \param phase
+     * \param time - Elapsed time in seconds.
+     */
+    void recordPhaseTime(ParallelPhase phase, double time);
+
+    /*!
+     * \brief advanceThreadTuning - Moves to the next candidate number of threads at the end of a time step. After the last
+     * candidate, keeps the fastest number of threads of each phase and caches the choice.
+     */
+    void advanceThreadTuning();
+
+    /*!
+     * \brief threadTuningKey - Model size the tuned thread counts are cached for.
+     */
+    std::vector<int> threadTuningKey() const;
+
+    /*!
+     * \brief phaseThreads
+     * \param phase
+     * \return Number of threads of the parallel region of phase.
+     */
+    int phaseThreads(ParallelPhase phase) const;
+
+    /*!
+     * \brief computeElementPhases - Computes the derived hydraulics, dispersion and heat sources of the elements and copies them
+     * to the element state store in one parallel region. Each element is swept once for everything it derives from its own state
+     * and once more for the face Peclet numbers, which average the dispersion of its neighbours.
+     * \param checkFlowReversal - Check whether the flow of any element reversed since the last copy.
+     * \return True if a flow reversed.
+     */
+    bool computeElementPhases(bool checkFlowReversal);
+
     /*!
      * \brief applyInitialConditions
      */
@@ -592,9 +682,9 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
     double computeTimeStep();
 
     /*!
-     * \brief computeLongDispersion
+     * \brief computeJunctionDerivedHydraulics - Work shared by the threads of the parallel region in update() without a closing barrier.
      */
-    void computeLongDispersion();
+    void computeJunctionDerivedHydraulics();
 
     /*!
      * \brief solveHeat
@@ -602,6 +692,13 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
      */
     void solve(double timeStep);
 
+    /*!
+     * \brief continuousIntegration
+     * \return True if the implicit solver keeps its history across time steps. The forcing is then applied at the end
+     * of each time step and interpolated from the start of the step in computeDYDt.
+     */
+    bool continuousIntegration() const;
+
     /*!
      * \brief computeDYDt
      * \param model
@@ -612,6 +709,79 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
      */
     static void computeDYDt(double t, double y[], double dydt[], void *userData);
 
+    /*!
+     * \brief getSolverValues - Copies the element and MultiElement junction values to the solver state vector.
+     * \param values
+     */
+    void getSolverValues(FirstTouchVector<double> &values);
+
+    /*!
+     * \brief setSolverValues - Copies solver state vector values to the elements and MultiElement junctions.
+     * \param values
+     */
+    void setSolverValues(const FirstTouchVector<double> &values);
+
+    /*!
+     * \brief solveDecoupled - Integrates temperature and each solute with its own ODE solver. The variables are
+     * only coupled through the hydraulics, which are fixed over the time step, so each variable block is solved
+     * concurrently with its own step size and error control.
+     * \param timeStep
+     * \return True if all the variable solves succeeded.
+     */
+    bool solveDecoupled(double timeStep);
+
+    /*!
+     * \brief computeJacobian - Updates the sparse Jacobian of computeDYDt. The analytic Jacobian of the linear
+     * schemes is assembled once per time step from the transport operator. TVD falls back to grouped difference quotients.
+     * \param t
+     * \param y
+     * \param fy - Derivatives at y.
+     * \param userData
+     */
+    static void computeJacobian(double t, double y[], double fy[], void *userData);
+
+    /*!
+     * \brief computeJacobianTimesVector - Computes Jv using the sparse Jacobian last updated by computeJacobian.
+     * \param t
+     * \param v
+     * \param Jv
+     * \param userData
+     */
+    static void computeJacobianTimesVector(double t, double v[], double Jv[], void *userData);
+
+    /*!
+     * \brief setupPreconditioner - Factorizes I - gamma * J with the tree solver or the reach blocks for the
+     * preconditioner of the implicit solver.
+     * \param t
+     * \param y
+     * \param fy
+     * \param jacobianCurrent - True if the Jacobian was just updated.
+     * \param gamma
+     * \param userData
+     * \return False if the factorization failed.
+     */
+    static bool setupPreconditioner(double t, double y[], double fy[], bool jacobianCurrent, double gamma, void *userData);
+
+    /*!
+     * \brief solvePreconditioner - Applies the preconditioner set up by setupPreconditioner.
+     * \param t
+     * \param r
+     * \param z
+     * \param gamma
+     * \param userData
+     */
+    static void solvePreconditioner(double t, double r[], double z[], double gamma, void *userData);
+
+    /*!
+     * \brief computeVariableDYDt - Computes the derivatives of the variable block identified by SolverUserData::variableIndex
+     * (0 for temperature and j + 1 for solute j).
+     * \param t
+     * \param y - Variable block of the solver state vector.
+     * \param dydt - Variable block of the solver derivative vector.
+     * \param userData
+     */
+    static void computeVariableDYDt(double t, double y[], double dydt[], void *userData);
+
     /*!
      * \brief solveJunctionHeatContinuity Solve
      * \param timeStep
@@ -711,6 +881,15 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
      */
     void writeOutput();
 
+    /*!
+     * \brief writeDenseOutput - Writes the output of every report time passed by the last time step. The element
+     * temperatures, solute concentrations and cross-sectional areas are set to the cubic Hermite interpolant of the
+     * solver values and derivatives at the start and end of the time step before writing and restored afterwards.
+     * The heat and mass balances are reported as accumulated to the end of the time step. When the solver failed the
+     * elements are written as they are without interpolation.
+     */
+    void writeDenseOutput();
+
     /*!
      * \brief writeCSVOutput
      */
@@ -765,6 +944,7 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
     //Time variables
     double m_timeStep, //seconds
     m_prevTimeStep, //previous timesetp
+    m_solverTime = 0.0, //Elapsed solver time at the start of the time step (seconds)
     m_startDateTime, //Modified Julian Day
     m_endDateTime, //Modified Julian Day
     m_currentDateTime, //Modified Julian Day
@@ -774,6 +954,7 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
     m_outputInterval, //seconds
     m_nextOutputTime,//Julian Day
     m_timeStepRelaxationFactor,
+    m_forcingDiscontinuityTolerance = 0.5, //Change of a forcing value over a time step relative to the scale of its forcing array that restarts the continuous integration
     m_maxTemp, //Tracks maximum temperature so far
     m_minTemp, //Tracks minimum temperature so far
     m_pressureRatio; //Pressure
@@ -783,10 +964,24 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
     m_totalSoluteMassBalance, // Tracks total mass balance of solutes (kg)
     m_totalAdvDispSoluteMassBalance, //Tracks total mass balance from advection and dispersion (kg)
     m_totalExternalSoluteFluxMassBalance, //Tracks total mass balance from external sources (kg)
-    m_solverCurrentValues,
-    m_solverOutputValues,
+    m_balancePartials, //Compensated heat and solute balance sums of each element block followed by their compensations
+    m_balanceTotals, //Compensated running heat and solute balance totals followed by their compensations
+    m_extremaPartials, //Minimum and maximum temperature and solute concentrations of each element block
     m_solute_first_order_k;
 
+    //Solver vectors first touched by the threads that own their elements
+    FirstTouchVector<double> m_solverCurrentValues,
+    m_solverOutputValues,
+    m_decoupledSolverValues, //Full size solver state shared by the decoupled variable solves
+    m_decoupledSolverDerivatives, //Full size solver derivatives shared by the decoupled variable solves
+    m_denseOutputStartValues, //Solver values at the start of a time step that passes a report time
+    m_denseOutputStartDerivatives, //Solver derivatives at the start of a time step that passes a report time
+    m_denseOutputEndDerivatives, //Solver derivatives at the end of a time step that passes a report time
+    m_denseOutputValues; //Solver values interpolated to a report time
+
+    std::vector<int> m_variableSolverOffsets; //Start of each variable's block in the solver vector (temperature followed by solutes)
+    std::vector<int> m_variableSolverThreads; //Threads of the nested team evaluating the right hand side of each decoupled solve
+
     int m_numInitFixedTimeSteps, //Number of initial fixed timeSteps of the minimum timestep to use when using the adaptive time step;
     m_numCurrentInitFixedTimeSteps, //Count number of initial minimum timesteps that have been used
     m_printFrequency, //Number of timesteps before printing
@@ -795,7 +990,13 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
     m_currentflushToDiskCount, //Number of timesteps that have been stored in memory so far since the last flush to disk
     m_addedSoluteCount,
     m_numSolutes = 0,
-    m_solverSize = 0;
+    m_solverSize = 0,
+    m_limitingElement = -1, //Index of the element with the largest Courant and dispersion factor in the last adaptive time step
+    m_phaseThreads[NumParallelPhases] = {}, //Tuned number of threads of each parallel phase. Zero uses the default.
+    m_threadTuningStep = -1; //Time steps since thread tuning started or -1 when not tuning
+
+    std::vector<int> m_threadCandidates; //Numbers of threads tried by the thread tuning
+    std::vector<double> m_threadTuningTimes; //Fastest time of each candidate number of threads and phase
 
     double m_computeDispersion; //Override user provided dispersion and compute dispersion based on Fisher
     bool m_useAdaptiveTimeStep, //Use the adaptive time step option
@@ -805,7 +1006,24 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
     m_useConvection,
     m_simulateWaterAge = false,
     m_solveHydraulics = false,
-    m_computeFluidFrictionHeat = false;
+    m_computeFluidFrictionHeat = false,
+    m_useFaceFluxAssembly = false, //Compute each interior face flux once and scatter it to both neighbouring elements
+    m_useLinearTransportOperator = false, //Assemble the advection-dispersion terms as a sparse matrix once per time step
+    m_useDecoupledSolves = false, //Integrate temperature and each solute with its own ODE solver concurrently
+    m_useTreeLinearSolver = false, //Solve the implicit Newton systems directly when the network is a tree
+    m_useReachBlockPreconditioner = false, //Precondition the Krylov linear solver with tridiagonal reach blocks
+    m_useContinuousIntegration = false, //Keep the implicit solver history across time steps and interpolate the forcing within each step
+    m_useDenseOutput = false, //Interpolate the output to the report times instead of shortening the time step to land on them
+    m_denseOutputReady = false, //The last time step saved the values needed to interpolate the output
+    m_solverDiscontinuity = false, //Restart the continuous integration at the next solve
+    m_advectionFunctionsChanged = true, //An element set its advection functions again since the flux kernel face groups were built
+    m_useSubnetworkTasks = false, //Run the element phases as tasks over subnetworks instead of static loops
+    m_useThreadTuning = false, //Tune the number of threads of each parallel phase at startup
+    m_useThreadBinding = false, //Bind the OpenMP threads to processors before the element state is first touched
+    m_useElementReordering = false, //Renumber the elements and junctions along the drainage tree at initialization
+    m_useInterleavedSolverLayout = false, //Place the variables of each element next to each other in the solver vector
+    m_useSolverBufferSwap = false, //Swap the solver buffers between time steps instead of reloading them from the elements and copying the prev values
+    m_solverBuffersHoldState = false; //The solver output buffer holds the state of the last time step and the other buffer the one before it
 
     std::unordered_map<std::string, QSharedPointer<TimeSeries>> m_timeSeries;
 
@@ -815,17 +1033,54 @@ class CSHCOMPONENT_EXPORT CSHModel : public QObject
     //Element junctions
     std::vector<ElementJunction*> m_eligibleJunctions;
     std::vector<ElementJunction*> m_elementJunctions;
+    std::vector<ElementJunction*> m_inputOrderElementJunctions; //Order the junctions were added in, used for output
     std::unordered_map<std::string, ElementJunction*> m_elementJunctionsById; //added for fast lookup using identifiers instead of indexes.
 
+    //Incoming then outgoing elements of each junction in junction order (compressed sparse rows)
+    std::vector<Element*> m_junctionElements;
+
     //1D Computational elements
     std::vector<Element*> m_elements;
+    std::vector<Element*> m_inputOrderElements; //Order the elements were added in, used for output
     std::unordered_map<std::string, Element*> m_elementsById; //added for fast lookup using identifiers instead of indexes.
 
+    //Per element and per junction arrays laid out in the order they are created
+    ModelArena m_arena;
+
+    //Contiguous copy of the element variables read by the right hand side of the transport equations
+    ElementStateStore m_elementState;
+
+    //Compile-time specialized advection and dispersion kernels over m_elementState
+    ElementFluxKernels m_fluxKernels;
+
+    //Runs the element phases as tasks over subnetworks of the element graph
+    SubnetworkScheduler m_subnetworkScheduler;
+
+    //Linear advection-dispersion operator applied to temperature and all solutes at once
+    TransportOperator m_transportOperator;
+
+    //Sparse Jacobian of the transport equations supplied to the implicit solver
+    TransportJacobian m_transportJacobian;
+
+    //Exact linear time solver of the implicit Newton systems on dendritic networks
+    TreeLinearSolver m_treeLinearSolver;
+
+    //Block-Jacobi preconditioner over the unbranched reaches for the Krylov linear solvers
+    ReachBlockPreconditioner m_reachBlockPreconditioner;
+
     //Boundary conditions list
     std::vector<IBoundaryCondition*> m_boundaryConditions;
 
     ODESolver *m_odeSolver = nullptr;
 
+#ifdef USE_CVODE
+    //BDF solver using the sparse Jacobian when the flows are prescribed
+    ImplicitTransportSolver *m_implicitSolver = nullptr;
+#endif
+
+    //ODE solvers of the temperature and solute blocks when the variables are solved decoupled
+    std::vector<ODESolver*> m_variableODESolvers;
+
     //Global water properties
     double m_waterDensity, //kg/m^3
     m_cp,// 4187.0; // J/kg/C
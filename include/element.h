@@ -71,6 +71,8 @@ struct CSHCOMPONENT_EXPORT Element
    friend class ElementAdvULTIMATE;
    friend class ElementAdvTVD;
    friend class CSHModel;
+   friend struct ElementStateStore;
+   friend class ElementFluxKernels;
 
    enum XSectType
    {
@@ -94,6 +96,11 @@ struct CSHCOMPONENT_EXPORT Element
     */
    ~Element();
 
+   /*!
+    * \brief index - Position of this element in the model's element list and state store.
+    */
+   int index;
+
    /*!
     * \brief hIndex
     */
@@ -135,7 +142,7 @@ struct CSHCOMPONENT_EXPORT Element
    Variable temperature;
 
    /*!
-    * \brief prevTemperature (°C)
+    * \brief prevTemperature (°C) - Not updated when SWAP_SOLVER_BUFFERS is on. The solver buffer the time step starts from holds the previous values.
     */
    Variable prevTemperature;
 
@@ -150,7 +157,7 @@ struct CSHCOMPONENT_EXPORT Element
    Variable *soluteConcs;
 
    /*!
-    * \brief prevSoluteConcs (kg/m^3)
+    * \brief prevSoluteConcs (kg/m^3) - Not updated when SWAP_SOLVER_BUFFERS is on.
     */
    Variable *prevSoluteConcs;
 
@@ -395,6 +402,40 @@ struct CSHCOMPONENT_EXPORT Element
     */
    double downstreamElementDirection;
 
+   /*!
+    * \brief upstreamDistance - Distance between the centers of the element and its upstream element, or half the length
+    * of the element when there is no upstream element (m).
+    */
+   double upstreamDistance;
+
+   /*!
+    * \brief downstreamDistance - Distance between the centers of the element and its downstream element, or half the length
+    * of the element when there is no downstream element (m).
+    */
+   double downstreamDistance;
+
+   /*!
+    * \brief upstreamNeighbourWeight - Inverse distance weight of the upstream element at the upstream face. It is also the
+    * linear interpolation factor of the element at that face. Zero when there is no upstream element.
+    */
+   double upstreamNeighbourWeight;
+
+   /*!
+    * \brief upstreamCenterWeight - Inverse distance weight of the element at the upstream face.
+    */
+   double upstreamCenterWeight;
+
+   /*!
+    * \brief downstreamNeighbourWeight - Inverse distance weight of the downstream element at the downstream face. It is also the
+    * linear interpolation factor of the element at that face. Zero when there is no downstream element.
+    */
+   double downstreamNeighbourWeight;
+
+   /*!
+    * \brief downstreamCenterWeight - Inverse distance weight of the element at the downstream face.
+    */
+   double downstreamCenterWeight;
+
    /*!
     * \brief distanceFromUpStreamJunction
     */
@@ -657,11 +698,24 @@ struct CSHCOMPONENT_EXPORT Element
     */
    double computeDispersionFactor() const;
 
+   /*!
+    * \brief computeGeometricCoefficients - Computes the face distances and interpolation weights from the lengths of the element
+    * and its neighbours. Called by initialize and needs to be called again only when a length changes.
+    */
+   void computeGeometricCoefficients();
+
    /*!
     * \brief computeDerivedHydraulics
     */
    void computeDerivedHydraulics();
 
+   /*!
+    * \brief computeAdvectionRegime - Flow direction and, for the hybrid scheme, the class of the face Peclet numbers, which together
+    * with the fixed boundary conditions select the advection functions. The advection functions are only set again when it changes.
+    * \return
+    */
+   int computeAdvectionRegime() const;
+
    /*!
     * \brief computeLongDispersion
     */
@@ -684,14 +738,16 @@ struct CSHCOMPONENT_EXPORT Element
 
    /*!
     * \brief computeHeatBalance
+    * \param previousTemperature - Temperature at the start of the time step.
     */
-   void computeHeatBalance(double timeStep);
+   void computeHeatBalance(double timeStep, double previousTemperature);
 
    /*!
     * \brief computeSoluteBalance
     * \param soluteIndex
+    * \param previousSoluteConc - Solute concentration at the start of the time step.
     */
-   void computeSoluteBalance(double timeStep, int soluteIndex);
+   void computeSoluteBalance(double timeStep, int soluteIndex, double previousSoluteConc);
 
    /*!
     * \brief initializeSolutes
@@ -827,6 +883,16 @@ struct CSHCOMPONENT_EXPORT Element
     */
    SetAdvectionFuctions setAdvectionFuctions;
 
+   /*!
+    * \brief currentAdvectionRegime - Regime the advection functions were last set for. -1 until they are set after initialization.
+    */
+   int currentAdvectionRegime;
+
+   /*!
+    * \brief advectionDispatchCount - Number of times the advection functions were set since initialization.
+    */
+   long advectionDispatchCount;
+
 };
 
 #endif // ELEMENT_H
@@ -0,0 +1,200 @@
+/*!
+*  \file    elementfluxkernels.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#ifndef ELEMENTFLUXKERNELS_H
+#define ELEMENTFLUXKERNELS_H
+
+#include "cshcomponent_global.h"
+
+#include <vector>
+
+struct Element;
+struct ElementStateStore;
+
+/*!
+ * \brief The ElementFluxKernels class evaluates the advection and dispersion terms of the element
+ * temperature and solute equations without calling through the per-element function pointer tables.
+ * Once per time step the face fluxes selected by the advection scheme and Element::setDispersionFunctions
+ * are classified and the element indexes are grouped by face flux type. Each group is then evaluated by a
+ * compile-time specialized kernel that reads the ElementStateStore arrays. Advection functions without a
+ * kernel (TVD) are grouped as ElementFunction and called through the element's function pointer.
+ *
+ * With face assembly enabled, each interior face between two neighbouring elements is evaluated once,
+ * using the upstream face flux of the downstream element, and scattered with opposite signs to both
+ * elements so that the advective and dispersive fluxes are conservative by construction.
+ */
+class CSHCOMPONENT_EXPORT ElementFluxKernels
+{
+    friend class TransportOperator;
+
+  public:
+
+    /*!
+     * \brief The AdvectionFlux enum - Advection face fluxes with a specialized kernel.
+     */
+    enum AdvectionFlux
+    {
+      UpwindInFluxUpJunction,
+      UpwindInFluxUpJunctionBC,
+      UpwindInFluxUpNeighbour,
+      UpwindInFluxSelf,
+      UpwindOutFluxSelf,
+      UpwindOutFluxDownJunction,
+      UpwindOutFluxDownJunctionBC,
+      UpwindOutFluxDownNeighbour,
+      CentralFluxUpNeighbour,
+      CentralFluxDownNeighbour,
+      HybridFluxUpNeighbour,
+      HybridFluxDownNeighbour,
+      ElementFunction,
+      NumAdvectionFluxes
+    };
+
+    /*!
+     * \brief The DispersionFlux enum - Dispersion face fluxes with a specialized kernel.
+     */
+    enum DispersionFlux
+    {
+      DispersionUpJunction,
+      DispersionUpJunctionBC,
+      DispersionUpNeighbour,
+      DispersionDownJunction,
+      DispersionDownJunctionBC,
+      DispersionDownNeighbour,
+      DispersionSelf,
+      NumDispersionFluxes
+    };
+
+    /*!
+     * \brief ElementFluxKernels
+     */
+    ElementFluxKernels();
+
+    /*!
+     * \brief initialize - Sizes the face groups and scratch arrays.
+     * \param state - Element state store the kernels read from.
+     * \param faceAssembly - Compute each interior face flux once and scatter it to both neighbours.
+     */
+    void initialize(const ElementStateStore *state, bool faceAssembly = false);
+
+    /*!
+     * \brief classify - Groups the elements by the face fluxes currently assigned to them.
+     * \param elements - Elements ordered by Element::index.
+     */
+    void classify(const std::vector<Element*> &elements);
+
+    /*!
+     * \brief faceAssembly
+     * \return True if interior face fluxes are computed once and scattered to both neighbours.
+     */
+    bool faceAssembly() const;
+
+    /*!
+     * \brief computeDTDt - Computes the temperature derivatives of all elements. Must be called by every thread of the
+     * enclosing parallel region like computeDerivatives. The derivatives are not synchronized on return.
+     * \param T - Solver state vector.
+     * \param DTDt - Solver derivative vector written at each element's tIndex.
+     */
+    void computeDTDt(const double T[], double DTDt[]);
+
+    /*!
+     * \brief computeDSoluteDt - Computes the solute derivatives of all elements for one solute. Must be called by every
+     * thread of the enclosing parallel region like computeDerivatives. The derivatives are not synchronized on return.
+     * \param soluteIndex
+     * \param firstOrderK - First order reaction rate constant of the solute (1/s).
+     * \param S - Solver state vector.
+     * \param DSoluteDt - Solver derivative vector written at each element's sIndex.
+     */
+    void computeDSoluteDt(int soluteIndex, double firstOrderK, const double S[], double DSoluteDt[]);
+
+    /*!
+     * \brief computeDerivatives - Computes the temperature and solute derivatives of all elements. Must be called by every
+     * thread of the enclosing parallel region, which it does not leave, so the face fluxes of all the variables are evaluated
+     * before a single barrier. The derivatives are not synchronized on return.
+     * \param firstOrderK - First order reaction rate constants of the solutes (1/s).
+     * \param y - Solver state vector.
+     * \param dydt - Solver derivative vector.
+     */
+    void computeDerivatives(const std::vector<double> &firstOrderK, const double y[], double dydt[]);
+
+  private:
+
+    /*!
+     * \brief groupIndex - Index into the face groups for a variable, face slot (0 upstream, 1 downstream) and flux type.
+     */
+    static int groupIndex(int variable, int slot, int flux, int numFluxes);
+
+    /*!
+     * \brief advectionFluxType - Maps the advection function of an element face to its kernel.
+     */
+    static int advectionFluxType(const Element *element, int variable, int slot);
+
+    /*!
+     * \brief dispersionFluxType - Maps the dispersion function of an element face to its kernel.
+     */
+    static int dispersionFluxType(const Element *element, int variable, int slot);
+
+    /*!
+     * \brief isInteriorFace - True if the upstream face of the element is shared with its upstream
+     * neighbour and face assembly is enabled.
+     */
+    bool isInteriorFace(int elementIndex, int variable) const;
+
+    /*!
+     * \brief computeElementFunctionGroup - Evaluates a group of faces through the element advection function pointers.
+     */
+    void computeElementFunctionGroup(int variable, int slot, const std::vector<int> &faces,
+                                     const double y[], double fluxes[], double downstreamFluxes[]);
+
+    /*!
+     * \brief computeFluxes - Evaluates the grouped advection and dispersion face fluxes of one variable. The groups
+     * are shared by the threads of the enclosing parallel region without synchronization.
+     */
+    void computeFluxes(int variable, bool heat, const double y[]);
+
+    /*!
+     * \brief computeTemperatureRates - Sums the temperature face fluxes and sources of each element.
+     */
+    void computeTemperatureRates(const double T[], double DTDt[]);
+
+    /*!
+     * \brief computeSoluteRates - Sums the solute face fluxes, reactions and sources of each element.
+     */
+    void computeSoluteRates(int soluteIndex, double firstOrderK, const double S[], double DSoluteDt[]);
+
+  private:
+    const ElementStateStore *m_state;
+    const std::vector<Element*> *m_elements;
+    int m_numVariables;
+    bool m_faceAssembly;
+
+    //Element indexes grouped by [variable][slot][flux]
+    std::vector<std::vector<int>> m_advectionFaces;
+    std::vector<std::vector<int>> m_dispersionFaces;
+
+    //Downstream elements of interior faces grouped by [variable][flux]
+    std::vector<std::vector<int>> m_interiorAdvectionFaces;
+    std::vector<std::vector<int>> m_interiorDispersionFaces;
+
+    //Upstream and downstream face flux scratch [variable][slot][elementIndex]
+    std::vector<std::vector<double>> m_advectionFluxes;
+    std::vector<std::vector<double>> m_dispersionFluxes;
+};
+
+#endif // ELEMENTFLUXKERNELS_H
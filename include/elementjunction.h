@@ -44,6 +44,19 @@ struct CSHCOMPONENT_EXPORT ElementJunction
       MultiElement = 3
     };
 
+    /*!
+     * \brief The ElementRange struct is a contiguous range of the junction adjacency of the model.
+     */
+    struct ElementRange
+    {
+        Element **first = nullptr;
+        Element **last = nullptr;
+
+        Element **begin() const { return first; }
+        Element **end() const { return last; }
+        int size() const { return last - first; }
+    };
+
     /*!
      * \brief ElementJunction
      * \param numsolutes - Number of solutes
@@ -102,7 +115,7 @@ struct CSHCOMPONENT_EXPORT ElementJunction
     Variable temperature;
 
     /*!
-     * \brief prevTemperature
+     * \brief prevTemperature - Not updated when SWAP_SOLVER_BUFFERS is on.
      */
     Variable prevTemperature;
 
@@ -112,7 +125,7 @@ struct CSHCOMPONENT_EXPORT ElementJunction
     Variable *soluteConcs;
 
     /*!
-     * \brief prevSoluteConcs
+     * \brief prevSoluteConcs - Not updated when SWAP_SOLVER_BUFFERS is on.
      */
     Variable *prevSoluteConcs;
 
@@ -126,6 +139,16 @@ struct CSHCOMPONENT_EXPORT ElementJunction
      */
     std::set<Element*> outgoingElements;
 
+    /*!
+     * \brief incoming - incomingElements in element order, built by CSHModel::initializeElements for the per step loops.
+     */
+    ElementRange incoming;
+
+    /*!
+     * \brief outgoing - outgoingElements in element order, built by CSHModel::initializeElements for the per step loops.
+     */
+    ElementRange outgoing;
+
     /*!
      * \brief junctionType
      */
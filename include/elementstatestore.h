@@ -0,0 +1,293 @@
+/*!
+*  \file    elementstatestore.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#ifndef ELEMENTSTATESTORE_H
+#define ELEMENTSTATESTORE_H
+
+#include "cshcomponent_global.h"
+#include "firsttouchallocator.h"
+
+#include <vector>
+
+struct Element;
+
+/*!
+ * \brief The ElementStateStore struct holds the element quantities read by the right hand side
+ * of the transport equations as contiguous arrays (structure of arrays) indexed by Element::index.
+ * Element remains the public facade. The store is refreshed from the elements once per time step
+ * after the derived hydraulics have been computed so that the ODE solver callbacks only touch these arrays.
+ * The arrays of element quantities are first touched with the static partition of the element loops so that
+ * each thread reads them from its local memory node.
+ */
+struct CSHCOMPONENT_EXPORT ElementStateStore
+{
+    /*!
+     * \brief ElementStateStore
+     */
+    ElementStateStore();
+
+    /*!
+     * \brief initialize - Sizes the arrays and copies the topology, geometric coefficients and solver indexes of the elements.
+     * \param elements - Elements ordered by Element::index.
+     * \param numSolutes - Number of solutes including water age.
+     */
+    void initialize(const std::vector<Element*> &elements, int numSolutes);
+
+    /*!
+     * \brief update - Copies the derived hydraulics, dispersion and heat sources of the elements. The copy is shared
+     * by the threads of the enclosing parallel region when called inside one.
+     * \param elements - Elements ordered by Element::index.
+     */
+    void update(const std::vector<Element*> &elements);
+
+    /*!
+     * \brief updateHydraulics - Copies the variables that change when the hydraulics are solved
+     * alongside transport.
+     * \param element
+     */
+    void updateHydraulics(const Element *element);
+
+    /*!
+     * \brief updateForcingInterval - Saves the heat sources, junction boundary values and external solute fluxes copied by
+     * the last update as the end of the forcing interval of the time step. The end of the previous interval becomes the start
+     * of the new one so that the forcing is continuous across time steps.
+     * \param restart - Start the interval from the current forcing instead.
+     * \param tolerance - Largest change of a forcing value over the interval, relative to the scale of its forcing array,
+     * that is still treated as continuous.
+     * \param floor - Absolute floor added to the forcingScales of each array to form its scale.
+     * \return True if a forcing value changed by more than the tolerance over the interval.
+     */
+    bool updateForcingInterval(bool restart, double tolerance, double floor);
+
+    /*!
+     * \brief interpolateForcing - Sets the forcing arrays to the linear interpolation between the start and end of the forcing interval.
+     * \param weight - Elapsed fraction of the interval between 0 and 1.
+     */
+    void interpolateForcing(double weight);
+
+    /*!
+     * \brief numElements
+     */
+    int numElements;
+
+    /*!
+     * \brief numSolutes
+     */
+    int numSolutes;
+
+    /*!
+     * \brief tIndex - Temperature solver index of each element.
+     */
+    std::vector<int> tIndex;
+
+    /*!
+     * \brief sIndex - Solute solver indexes for each solute [soluteIndex][elementIndex].
+     */
+    std::vector<std::vector<int>> sIndex;
+
+    /*!
+     * \brief upstreamElement - Index of the upstream neighbour element or -1.
+     */
+    std::vector<int> upstreamElement;
+
+    /*!
+     * \brief downstreamElement - Index of the downstream neighbour element or -1.
+     */
+    std::vector<int> downstreamElement;
+
+    /*!
+     * \brief upstreamJunctionTIndex - Temperature solver index of the upstream junction of each element.
+     */
+    std::vector<int> upstreamJunctionTIndex;
+
+    /*!
+     * \brief downstreamJunctionTIndex - Temperature solver index of the downstream junction of each element.
+     */
+    std::vector<int> downstreamJunctionTIndex;
+
+    /*!
+     * \brief upstreamJunctionSIndex - Solute solver indexes of the upstream junction [soluteIndex][elementIndex].
+     */
+    std::vector<std::vector<int>> upstreamJunctionSIndex;
+
+    /*!
+     * \brief downstreamJunctionSIndex - Solute solver indexes of the downstream junction [soluteIndex][elementIndex].
+     */
+    std::vector<std::vector<int>> downstreamJunctionSIndex;
+
+    /*!
+     * \brief inverseHalfLength - Inverse of the distance between the center of the element and its junctions (1/m).
+     */
+    FirstTouchVector<double> inverseHalfLength;
+
+    /*!
+     * \brief upstreamInverseDistance - Inverse of Element::upstreamDistance used by the neighbour faces (1/m).
+     */
+    FirstTouchVector<double> upstreamInverseDistance;
+
+    /*!
+     * \brief downstreamInverseDistance - Inverse of Element::downstreamDistance used by the neighbour faces (1/m).
+     */
+    FirstTouchVector<double> downstreamInverseDistance;
+
+    /*!
+     * \brief upstreamNeighbourWeight - Element::upstreamNeighbourWeight.
+     */
+    FirstTouchVector<double> upstreamNeighbourWeight;
+
+    /*!
+     * \brief upstreamCenterWeight - Element::upstreamCenterWeight.
+     */
+    FirstTouchVector<double> upstreamCenterWeight;
+
+    /*!
+     * \brief downstreamNeighbourWeight - Element::downstreamNeighbourWeight.
+     */
+    FirstTouchVector<double> downstreamNeighbourWeight;
+
+    /*!
+     * \brief downstreamCenterWeight - Element::downstreamCenterWeight.
+     */
+    FirstTouchVector<double> downstreamCenterWeight;
+
+    /*!
+     * \brief flow (m^3/s)
+     */
+    FirstTouchVector<double> flow;
+
+    /*!
+     * \brief volume (m^3)
+     */
+    FirstTouchVector<double> volume;
+
+    /*!
+     * \brief sol_volume (m^3)
+     */
+    FirstTouchVector<double> sol_volume;
+
+    /*!
+     * \brief dvolume_dt (m^3/s)
+     */
+    FirstTouchVector<double> dvolume_dt;
+
+    /*!
+     * \brief rho_cp
+     */
+    FirstTouchVector<double> rho_cp;
+
+    /*!
+     * \brief rho_cp_vol
+     */
+    FirstTouchVector<double> rho_cp_vol;
+
+    /*!
+     * \brief upstreamXSectionArea (m^2)
+     */
+    FirstTouchVector<double> upstreamXSectionArea;
+
+    /*!
+     * \brief downstreamXSectionArea (m^2)
+     */
+    FirstTouchVector<double> downstreamXSectionArea;
+
+    /*!
+     * \brief upstreamLongDispersion (m^2/s)
+     */
+    FirstTouchVector<double> upstreamLongDispersion;
+
+    /*!
+     * \brief downstreamLongDispersion (m^2/s)
+     */
+    FirstTouchVector<double> downstreamLongDispersion;
+
+    /*!
+     * \brief upstreamPecletNumber
+     */
+    FirstTouchVector<double> upstreamPecletNumber;
+
+    /*!
+     * \brief downstreamPecletNumber
+     */
+    FirstTouchVector<double> downstreamPecletNumber;
+
+    /*!
+     * \brief heatSources - Sum of the radiation, external, evaporation, convection and
+     * fluid friction heat fluxes divided by rho_cp_vol (°C/s).
+     */
+    FirstTouchVector<double> heatSources;
+
+    /*!
+     * \brief upstreamJunctionTemperature - Temperature of the upstream junction (°C).
+     */
+    FirstTouchVector<double> upstreamJunctionTemperature;
+
+    /*!
+     * \brief downstreamJunctionTemperature - Temperature of the downstream junction (°C).
+     */
+    FirstTouchVector<double> downstreamJunctionTemperature;
+
+    /*!
+     * \brief upstreamJunctionSoluteConcs - Solute concentrations of the upstream junction [soluteIndex][elementIndex] (kg/m^3).
+     */
+    std::vector<FirstTouchVector<double>> upstreamJunctionSoluteConcs;
+
+    /*!
+     * \brief downstreamJunctionSoluteConcs - Solute concentrations of the downstream junction [soluteIndex][elementIndex] (kg/m^3).
+     */
+    std::vector<FirstTouchVector<double>> downstreamJunctionSoluteConcs;
+
+    /*!
+     * \brief soluteConcs - Solute concentrations at the start of the time step [soluteIndex][elementIndex] (kg/m^3).
+     */
+    std::vector<FirstTouchVector<double>> soluteConcs;
+
+    /*!
+     * \brief externalSoluteFluxes - External solute fluxes [soluteIndex][elementIndex] (kg/s).
+     */
+    std::vector<FirstTouchVector<double>> externalSoluteFluxes;
+
+    /*!
+     * \brief forcingWeight - Weight of the last interpolateForcing call or -1 if the forcing arrays hold the values copied by update.
+     */
+    double forcingWeight;
+
+    /*!
+     * \brief startForcing - Forcing arrays at the start of the forcing interval concatenated in the order of forcingArrays.
+     */
+    std::vector<double> startForcing;
+
+    /*!
+     * \brief endForcing - Forcing at the end of the interval laid out as startForcing.
+     */
+    std::vector<double> endForcing;
+
+    /*!
+     * \brief forcingScales - Largest magnitude each forcing array has reached since the forcing interval was restarted.
+     */
+    std::vector<double> forcingScales;
+
+  private:
+
+    /*!
+     * \brief forcingArrays - Forcing arrays in the order they are concatenated in startForcing and endForcing.
+     */
+    std::vector<FirstTouchVector<double>*> forcingArrays();
+};
+
+#endif // ELEMENTSTATESTORE_H
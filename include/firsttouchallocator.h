@@ -0,0 +1,94 @@
+/*!
+*  \file    firsttouchallocator.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#ifndef FIRSTTOUCHALLOCATOR_H
+#define FIRSTTOUCHALLOCATOR_H
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*!
+ * \brief The FirstTouchAllocator class is a std::allocator that default initializes the elements a vector is resized with.
+ * The memory of arithmetic types is then left untouched until it is first written, so it can be placed by the threads that
+ * own it under a first touch memory policy.
+ */
+template<typename T>
+class FirstTouchAllocator : public std::allocator<T>
+{
+  public:
+
+    template<typename U>
+    struct rebind
+    {
+        typedef FirstTouchAllocator<U> other;
+    };
+
+    FirstTouchAllocator() noexcept
+    {
+    }
+
+    template<typename U>
+    FirstTouchAllocator(const FirstTouchAllocator<U> &) noexcept
+    {
+    }
+
+    /*!
+     * \brief construct - Default initializes instead of value initializing.
+     */
+    template<typename U>
+    void construct(U *p)
+    {
+      ::new(static_cast<void*>(p)) U;
+    }
+
+    template<typename U, typename... Args>
+    void construct(U *p, Args&&... args)
+    {
+      ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+template<typename T>
+using FirstTouchVector = std::vector<T, FirstTouchAllocator<T>>;
+
+/*!
+ * \brief firstTouchAssign - Replaces values with size new elements set to value by a static work sharing loop over the
+ * elements so that each page is first touched by the thread that owns it in the static loops of the model.
+ * \param values
+ * \param size
+ * \param value
+ */
+template<typename T>
+void firstTouchAssign(FirstTouchVector<T> &values, int size, const T &value)
+{
+  FirstTouchVector<T>(size).swap(values);
+  T *data = values.data();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int i = 0; i < size; i++)
+  {
+    data[i] = value;
+  }
+}
+
+#endif // FIRSTTOUCHALLOCATOR_H
@@ -0,0 +1,215 @@
+/*!
+*  \file    implicittransportsolver.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#ifndef IMPLICITTRANSPORTSOLVER_H
+#define IMPLICITTRANSPORTSOLVER_H
+
+#include "cshcomponent_global.h"
+#include "odesolver.h"
+#include "transportjacobian.h"
+
+#ifdef USE_CVODE
+
+#include <cvode/cvode.h>
+#include <nvector/nvector_serial.h>
+#include <sundials/sundials_linearsolver.h>
+
+//SUNDIALS 4 replaced the CVSpils interface with the CVLs interface and SUNDIALS 6 removed the old names
+#if SUNDIALS_VERSION_MAJOR >= 4
+#include <cvode/cvode_ls.h>
+#else
+#include <cvode/cvode_spils.h>
+#endif
+
+#if SUNDIALS_VERSION_MAJOR >= 7
+typedef sunrealtype realtype;
+typedef sunbooleantype booleantype;
+#endif
+
+/*!
+ * \brief JacobianSetupFunction - Called by the solver when the Jacobian needs to be updated at (t, y).
+ */
+typedef void (*JacobianSetupFunction)(double t, double y[], double fy[], void *userData);
+
+/*!
+ * \brief JacobianTimesVectorFunction - Computes the product Jv of the current Jacobian and v.
+ */
+typedef void (*JacobianTimesVectorFunction)(double t, double v[], double Jv[], void *userData);
+
+/*!
+ * \brief PreconditionerSetupFunction - Prepares the preconditioner of I - gamma * J at (t, y).
+ * Returns false if the preconditioner could not be set up.
+ */
+typedef bool (*PreconditionerSetupFunction)(double t, double y[], double fy[], bool jacobianCurrent, double gamma, void *userData);
+
+/*!
+ * \brief PreconditionerSolveFunction - Solves P z = r with the preconditioner P of I - gamma * J.
+ */
+typedef void (*PreconditionerSolveFunction)(double t, double r[], double z[], double gamma, void *userData);
+
+/*!
+ * \brief The ImplicitTransportSolver class integrates the transport equations with the CVODE BDF method and
+ * a Krylov linear solver that uses the Jacobian times vector products supplied by the model instead of
+ * approximating each product with a difference quotient and an extra right hand side evaluation.
+ */
+class CSHCOMPONENT_EXPORT ImplicitTransportSolver
+{
+  public:
+
+    /*!
+     * \brief ImplicitTransportSolver
+     * \param size - Size of the solver state vector.
+     * \param linearSolverType - Krylov linear solver used in the Newton iterations.
+     */
+    ImplicitTransportSolver(int size, ODESolver::LinearSolverType linearSolverType);
+
+    ~ImplicitTransportSolver();
+
+    /*!
+     * \brief setTolerances
+     * \param absoluteTolerance
+     * \param relativeTolerance
+     */
+    void setTolerances(double absoluteTolerance, double relativeTolerance);
+
+    /*!
+     * \brief setFunctions - Sets the right hand side and Jacobian callbacks.
+     * \param derivativeFunction
+     * \param jacobianSetupFunction
+     * \param jacobianTimesVectorFunction
+     */
+    void setFunctions(TransportDerivativeFunction derivativeFunction, JacobianSetupFunction jacobianSetupFunction,
+                      JacobianTimesVectorFunction jacobianTimesVectorFunction);
+
+    /*!
+     * \brief setPreconditioner - Sets the left preconditioner of the Krylov linear solver. Must be called before initialize.
+     * \param preconditionerSetupFunction
+     * \param preconditionerSolveFunction
+     */
+    void setPreconditioner(PreconditionerSetupFunction preconditionerSetupFunction,
+                           PreconditionerSolveFunction preconditionerSolveFunction);
+
+    /*!
+     * \brief initialize - Creates the CVODE memory, the state vector and the linear solver.
+     * \return True if CVODE was initialized successfully.
+     */
+    bool initialize();
+
+    /*!
+     * \brief setContinuous - Keeps the integrator history (step size, order and Newton matrix) across calls to solve
+     * instead of restarting CVODE at every call. The integrator is only restarted when solve is called with a time or
+     * state that differs from where the last call stopped or after requestReinitialization.
+     * \param continuous
+     */
+    void setContinuous(bool continuous);
+
+    /*!
+     * \brief isContinuous
+     */
+    bool isContinuous() const;
+
+    /*!
+     * \brief requestReinitialization - Restarts the integrator at the next call to solve, e.g. after a discontinuity
+     * in the right hand side.
+     */
+    void requestReinitialization();
+
+    /*!
+     * \brief solve - Integrates from t to t + dt.
+     * \param y - Values at t.
+     * \param size - Size of y.
+     * \param t - Start time.
+     * \param dt - Time step.
+     * \param yout - Values at t + dt.
+     * \param userData - User data passed to the callbacks.
+     * \return 0 on success and the CVODE error flag otherwise.
+     */
+    int solve(const double y[], int size, double t, double dt, double yout[], void *userData);
+
+    /*!
+     * \brief getIterations
+     * \return Number of internal steps taken during the last solve.
+     */
+    int getIterations() const;
+
+    /*!
+     * \brief maxIterations
+     */
+    int maxIterations() const;
+
+    /*!
+     * \brief setMaxIterations - Sets the maximum number of internal steps of a solve. Must be called before initialize.
+     * \param maxIterations
+     */
+    void setMaxIterations(int maxIterations);
+
+    /*!
+     * \brief getLinearIterations
+     * \return Total number of Krylov iterations.
+     */
+    int getLinearIterations() const;
+
+    /*!
+     * \brief getReinitializations
+     * \return Number of times the integrator was restarted.
+     */
+    int getReinitializations() const;
+
+  private:
+
+    static int computeDerivatives(realtype t, N_Vector y, N_Vector ydot, void *userData);
+
+    static int setupJacobianTimesVector(realtype t, N_Vector y, N_Vector fy, void *userData);
+
+    static int computeJacobianTimesVector(N_Vector v, N_Vector Jv, realtype t, N_Vector y, N_Vector fy,
+                                          void *userData, N_Vector tmp);
+
+    static int setupPreconditioner(realtype t, N_Vector y, N_Vector fy, booleantype jok, booleantype *jcurPtr,
+                                   realtype gamma, void *userData);
+
+    static int solvePreconditioner(realtype t, N_Vector y, N_Vector fy, N_Vector r, N_Vector z,
+                                   realtype gamma, realtype delta, int lr, void *userData);
+
+  private:
+    int m_size;
+    ODESolver::LinearSolverType m_linearSolverType;
+    double m_absoluteTolerance, m_relativeTolerance;
+    int m_iterations, m_maxIterations, m_reinitializations;
+    double m_currentTime;
+
+    TransportDerivativeFunction m_derivativeFunction;
+    JacobianSetupFunction m_jacobianSetupFunction;
+    JacobianTimesVectorFunction m_jacobianTimesVectorFunction;
+    PreconditionerSetupFunction m_preconditionerSetupFunction;
+    PreconditionerSolveFunction m_preconditionerSolveFunction;
+    void *m_userData;
+
+#if SUNDIALS_VERSION_MAJOR >= 6
+    SUNContext m_context;
+#endif
+
+    void *m_cvodeMemory;
+    N_Vector m_values;
+    SUNLinearSolver m_linearSolver;
+    bool m_cvodeInitialized, m_continuous, m_reinitialize;
+};
+
+#endif // USE_CVODE
+
+#endif // IMPLICITTRANSPORTSOLVER_H
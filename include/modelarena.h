@@ -0,0 +1,99 @@
+/*!
+*  \file    modelarena.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#ifndef MODELARENA_H
+#define MODELARENA_H
+
+#include "cshcomponent_global.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/*!
+ * \brief The ModelArena class carves the small per element and per junction arrays out of a few large blocks owned by the model.
+ * Arrays are placed one after the other in the order they are requested, so the arrays of the elements are laid out in the order
+ * the elements are created. Arrays are never freed individually. Their memory is released with the arena.
+ */
+class CSHCOMPONENT_EXPORT ModelArena
+{
+  public:
+
+    /*!
+     * \brief ModelArena
+     * \param blockSize - Size in bytes of the blocks arrays are carved from. Larger arrays get a block of their own.
+     */
+    ModelArena(size_t blockSize = 1 << 20);
+
+    ModelArena(const ModelArena &) = delete;
+
+    ModelArena &operator=(const ModelArena &) = delete;
+
+    ~ModelArena();
+
+    /*!
+     * \brief allocate - Returns an array of count value initialized values or nullptr when count is not positive.
+     */
+    template<typename T>
+    T *allocate(int count)
+    {
+      static_assert(std::is_trivially_destructible<T>::value, "Arena arrays are never destroyed");
+
+      if(count <= 0)
+        return nullptr;
+
+      T *values = static_cast<T*>(allocateBytes(sizeof(T) * count, alignof(T)));
+
+      for(int i = 0; i < count; i++)
+      {
+        ::new(static_cast<void*>(values + i)) T();
+      }
+
+      return values;
+    }
+
+    /*!
+     * \brief clear - Releases all the blocks. Arrays allocated before become invalid.
+     */
+    void clear();
+
+    /*!
+     * \brief numBlocks
+     */
+    size_t numBlocks() const;
+
+    /*!
+     * \brief bytesAllocated - Bytes handed out including alignment padding.
+     */
+    size_t bytesAllocated() const;
+
+  private:
+
+    void *allocateBytes(size_t size, size_t alignment);
+
+  private:
+    size_t m_blockSize;
+    size_t m_offset;
+    size_t m_bytesAllocated;
+    char *m_currentBlock;
+    std::vector<char*> m_blocks;
+};
+
+#endif // MODELARENA_H
@@ -0,0 +1,89 @@
+/*!
+*  \file    reachblockpreconditioner.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#ifndef REACHBLOCKPRECONDITIONER_H
+#define REACHBLOCKPRECONDITIONER_H
+
+#include "cshcomponent_global.h"
+
+#include <vector>
+
+struct ElementStateStore;
+class TransportJacobian;
+
+/*!
+ * \brief The ReachBlockPreconditioner class is a block-Jacobi preconditioner of I - gamma * J whose blocks are the
+ * maximal unbranched reaches of the network, i.e. chains of elements connected through DoubleElement junctions
+ * and bounded by MultiElement or boundary junctions. Each block keeps the coupling of an element to its upstream and
+ * downstream neighbours and is solved with the Thomas algorithm. Junction unknowns form blocks of their own.
+ * Coupling across junctions and the TVD second neighbours are dropped.
+ */
+class CSHCOMPONENT_EXPORT ReachBlockPreconditioner
+{
+  public:
+
+    /*!
+     * \brief ReachBlockPreconditioner
+     */
+    ReachBlockPreconditioner();
+
+    /*!
+     * \brief initialize - Finds the reaches and the positions of their tridiagonal coefficients in the Jacobian.
+     * \param jacobian - Jacobian the blocks are extracted from.
+     * \param state - Element state store holding the element topology and solver indexes.
+     */
+    void initialize(const TransportJacobian *jacobian, const ElementStateStore *state);
+
+    /*!
+     * \brief numBlocks
+     */
+    int numBlocks() const;
+
+    /*!
+     * \brief factorize - Factorizes the tridiagonal blocks of I - gamma * J using the current Jacobian values.
+     * \param gamma
+     * \return False if a zero pivot was encountered.
+     */
+    bool factorize(double gamma);
+
+    /*!
+     * \brief solve - Solves the block diagonal system P z = r.
+     * \param r
+     * \param z
+     */
+    void solve(const double r[], double z[]) const;
+
+  private:
+    const TransportJacobian *m_jacobian;
+
+    //Unknowns of each block ordered upstream to downstream [blockPointers[b], blockPointers[b+1])
+    std::vector<int> m_blockPointers;
+    std::vector<int> m_unknowns;
+
+    //Jacobian positions of the coupling of each block unknown to the previous and next unknown of its block
+    std::vector<int> m_lowerPositions;
+    std::vector<int> m_upperPositions;
+
+    //Thomas factors: lower coefficients, inverse pivots and normalized upper coefficients
+    std::vector<double> m_lower;
+    std::vector<double> m_inversePivots;
+    std::vector<double> m_upper;
+};
+
+#endif // REACHBLOCKPRECONDITIONER_H
@@ -0,0 +1,142 @@
+/*!
+*  \file    subnetworkscheduler.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#ifndef SUBNETWORKSCHEDULER_H
+#define SUBNETWORKSCHEDULER_H
+
+#include "cshcomponent_global.h"
+
+#include <vector>
+
+struct ElementStateStore;
+
+/*!
+ * \brief The SubnetworkScheduler class runs the element phases of a time step and of the right hand side over subnetworks
+ * of the element graph. A subnetwork holds consecutive elements of unbranched reaches so that a task walks neighbouring
+ * elements. Short reaches are packed together and long reaches are split so that there are several subnetworks per thread.
+ * When enabled, each subnetwork is an OpenMP task and idle threads take the remaining tasks of the team, which balances
+ * unevenly sized tributaries. Otherwise the elements are shared by a static work sharing loop.
+ *
+ * forEachElement is an orphaned work sharing construct and must be reached by all threads of the enclosing parallel region.
+ */
+class CSHCOMPONENT_EXPORT SubnetworkScheduler
+{
+  public:
+
+    /*!
+     * \brief SubnetworkScheduler
+     */
+    SubnetworkScheduler();
+
+    /*!
+     * \brief initialize - Partitions the elements into subnetworks.
+     * \param state - Element state store holding the element topology.
+     * \param enabled - Run the subnetworks as tasks.
+     */
+    void initialize(const ElementStateStore *state, bool enabled);
+
+    /*!
+     * \brief isEnabled
+     */
+    bool isEnabled() const;
+
+    /*!
+     * \brief numSubnetworks
+     */
+    int numSubnetworks() const;
+
+    /*!
+     * \brief forEachElement - Calls function with the index of each element.
+     * \param function - Called once per element index. It must only write to the element it is called with.
+     * \param wait - Wait for all elements before returning. Without it the elements are only complete at the next barrier,
+     * and when tasks are enabled a thread may run elements in any order, so only skip the wait when the following phase does
+     * not read what function writes.
+     */
+    template<typename Function>
+    void forEachElement(Function function, bool wait) const
+    {
+      if(m_enabled)
+      {
+#ifdef USE_OPENMP
+        if(wait)
+        {
+#pragma omp single
+          spawnTasks(function);
+        }
+        else
+        {
+#pragma omp single nowait
+          spawnTasks(function);
+        }
+#else
+        spawnTasks(function);
+#endif
+      }
+      else if(wait)
+      {
+#ifdef USE_OPENMP
+#pragma omp for schedule(static)
+#endif
+        for(int i = 0; i < m_numElements; i++)
+        {
+          function(i);
+        }
+      }
+      else
+      {
+#ifdef USE_OPENMP
+#pragma omp for schedule(static) nowait
+#endif
+        for(int i = 0; i < m_numElements; i++)
+        {
+          function(i);
+        }
+      }
+    }
+
+  private:
+
+    /*!
+     * \brief spawnTasks - Creates one task per subnetwork, largest first.
+     */
+    template<typename Function>
+    void spawnTasks(const Function &function) const
+    {
+      for(int s = 0; s < numSubnetworks(); s++)
+      {
+#ifdef USE_OPENMP
+#pragma omp task firstprivate(s, function)
+#endif
+        for(int k = m_subnetworkPointers[s]; k < m_subnetworkPointers[s + 1]; k++)
+        {
+          function(m_elements[k]);
+        }
+      }
+    }
+
+  private:
+    bool m_enabled;
+    int m_numElements;
+
+    //Elements of each subnetwork [subnetworkPointers[s], subnetworkPointers[s+1])
+    std::vector<int> m_subnetworkPointers;
+    std::vector<int> m_elements;
+};
+
+#endif // SUBNETWORKSCHEDULER_H
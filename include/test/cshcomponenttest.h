@@ -23,6 +23,8 @@
 
 #include <QtTest/QtTest>
 
+class CSHModel;
+
 class CSHComponentTest : public QObject
 {
     Q_OBJECT
@@ -86,6 +88,81 @@ class CSHComponentTest : public QObject
      */
     void green_river_test2();
 
+    /*!
+     * \brief transportJacobian_Upwind Compares the analytic transport Jacobian assembled for the upwind scheme
+     * against finite differences of CSHModel::computeDYDt on a branching network.
+     */
+    void transportJacobian_Upwind();
+
+    /*!
+     * \brief transportJacobian_TVD Compares the grouped difference quotient Jacobian used for the TVD scheme
+     * against finite differences of CSHModel::computeDYDt on a branching network.
+     */
+    void transportJacobian_TVD();
+
+    /*!
+     * \brief transportDerivatives_Upwind Compares CSHModel::computeDYDt evaluated through the flux kernels, face assembly
+     * and the linear transport operator against the element and junction equations for the upwind scheme.
+     */
+    void transportDerivatives_Upwind();
+
+    /*!
+     * \brief transportDerivatives_Central Compares CSHModel::computeDYDt evaluated through the flux kernels, face assembly
+     * and the linear transport operator against the element and junction equations for the central scheme.
+     */
+    void transportDerivatives_Central();
+
+    /*!
+     * \brief transportDerivatives_Hybrid Compares CSHModel::computeDYDt evaluated through the flux kernels, face assembly
+     * and the linear transport operator against the element and junction equations for the hybrid scheme.
+     */
+    void transportDerivatives_Hybrid();
+
+    /*!
+     * \brief continuousForcing_Diurnal Checks that smooth diurnal forcing that crosses zero does not restart the continuous
+     * integration while a step change of a boundary condition does.
+     */
+    void continuousForcing_Diurnal();
+
+    /*!
+     * \brief heatSoluteBalance_ThreadCount Checks that the heat and solute balances and the temperature and solute extremes
+     * of a branching network spanning several balance blocks are identical when run with one and with several threads.
+     */
+    void heatSoluteBalance_ThreadCount();
+
+    /*!
+     * \brief elementReordering_InputOrder Checks that renumbering the elements and junctions along the drainage tree
+     * does not change the results of a branching network reported in input order.
+     */
+    void elementReordering_InputOrder();
+
+  private:
+
+    /*!
+     * \brief createBranchingNetwork Creates a model with two tributaries with boundary condition inflows joining a main stem.
+     * The model is not initialized.
+     * \param advectionMode CSHModel::AdvectionDiscretizationMode of the model.
+     * \param refinement Multiplies the number of elements of each reach.
+     * \return The new model, owned by the caller.
+     */
+    static CSHModel *createBranchingNetwork(int advectionMode, int refinement = 1);
+
+    /*!
+     * \brief compareTransportJacobian Builds a branching network, assembles the sparse transport Jacobian
+     * through CSHModel::computeJacobian and checks every column against a one-sided difference of CSHModel::computeDYDt.
+     * \param advectionMode CSHModel::AdvectionDiscretizationMode to test.
+     * \param analytic Whether the Jacobian is expected to be assembled from the transport operator.
+     */
+    void compareTransportJacobian(int advectionMode, bool analytic);
+
+    /*!
+     * \brief compareTransportDerivatives Builds a branching network and checks CSHModel::computeDYDt with face assembly
+     * off and on and with the linear transport operator against Element::computeDTDt, Element::computeDSoluteDt and
+     * the junction equations evaluated one at a time.
+     * \param advectionMode CSHModel::AdvectionDiscretizationMode to test.
+     */
+    void compareTransportDerivatives(int advectionMode);
+
 };
 
 
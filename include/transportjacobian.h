@@ -0,0 +1,186 @@
+/*!
+*  \file    transportjacobian.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#ifndef TRANSPORTJACOBIAN_H
+#define TRANSPORTJACOBIAN_H
+
+#include "cshcomponent_global.h"
+
+#include <vector>
+
+struct ElementJunction;
+struct ElementStateStore;
+class TransportOperator;
+
+/*!
+ * \brief TransportDerivativeFunction - Right hand side of the transport equations evaluated by the solver.
+ */
+typedef void (*TransportDerivativeFunction)(double t, double y[], double dydt[], void *userData);
+
+/*!
+ * \brief The TransportJacobian class holds the Jacobian of the temperature and solute equations with
+ * respect to the solver state vector in compressed sparse row format. The sparsity pattern is built once
+ * from the network: each element row couples to itself, its upstream and downstream neighbours and junctions
+ * and, for TVD, to its second neighbours and their junctions. MultiElement junction rows couple to the junction
+ * and its incoming and outgoing elements.
+ *
+ * For the linear schemes the values are copied from the assembled TransportOperator and the junction equations
+ * and do not change until the hydraulics do. Otherwise the values are approximated by difference quotients over
+ * groups of structurally independent columns so that a full Jacobian costs a handful of right hand side
+ * evaluations instead of one per unknown.
+ */
+class CSHCOMPONENT_EXPORT TransportJacobian
+{
+  public:
+
+    /*!
+     * \brief TransportJacobian
+     */
+    TransportJacobian();
+
+    /*!
+     * \brief initialize - Builds the sparsity pattern and the column groups used by the difference quotients.
+     * \param state - Element state store holding the element topology and solver indexes.
+     * \param junctions - Junctions with solver indexes.
+     * \param size - Size of the solver state vector.
+     * \param secondNeighbours - Include the second neighbours read by the TVD flux limiters.
+     */
+    void initialize(const ElementStateStore *state, const std::vector<ElementJunction*> &junctions, int size, bool secondNeighbours);
+
+    /*!
+     * \brief assemble - Assembles the analytic Jacobian of the linear schemes.
+     * \param transportOperator - Assembled advection-dispersion operator of the elements.
+     * \return False if the operator is not assembled or has a term outside the sparsity pattern.
+     */
+    bool assemble(const TransportOperator &transportOperator);
+
+    /*!
+     * \brief assemble - Approximates the Jacobian by difference quotients over the column groups.
+     * \param function - Right hand side of the transport equations.
+     * \param userData - User data passed to the function.
+     * \param t - Time at which the Jacobian is evaluated.
+     * \param y - Solver state vector.
+     * \param fy - Right hand side evaluated at y.
+     */
+    void assemble(TransportDerivativeFunction function, void *userData, double t, const double y[], const double fy[]);
+
+    /*!
+     * \brief invalidate - Marks the values as out of date after the hydraulics change.
+     */
+    void invalidate();
+
+    /*!
+     * \brief isInitialized
+     */
+    bool isInitialized() const;
+
+    /*!
+     * \brief isAssembled
+     * \return True if the values are current.
+     */
+    bool isAssembled() const;
+
+    /*!
+     * \brief isApproximate
+     * \return True if the current values are difference quotients and depend on the state they were evaluated at.
+     */
+    bool isApproximate() const;
+
+    /*!
+     * \brief multiply - Computes the Jacobian times vector product Jv = J * v.
+     */
+    void multiply(const double v[], double Jv[]) const;
+
+    /*!
+     * \brief size
+     */
+    int size() const;
+
+    /*!
+     * \brief numNonZeros
+     */
+    int numNonZeros() const;
+
+    /*!
+     * \brief numColumnGroups - Number of right hand side evaluations needed by the difference quotients.
+     */
+    int numColumnGroups() const;
+
+    /*!
+     * \brief rowPointers
+     */
+    const std::vector<int> &rowPointers() const;
+
+    /*!
+     * \brief columns
+     */
+    const std::vector<int> &columns() const;
+
+    /*!
+     * \brief values
+     */
+    const std::vector<double> &values() const;
+
+    /*!
+     * \brief diagonal - Position of the diagonal entry of each row in columns() and values().
+     */
+    const std::vector<int> &diagonal() const;
+
+    /*!
+     * \brief find - Position of entry (row, column) or -1 if it is not in the sparsity pattern.
+     */
+    int find(int row, int column) const;
+
+  private:
+
+    /*!
+     * \brief addJunctionRow - Adds the analytic coefficients of a junction equation.
+     */
+    void addJunctionRow(const ElementJunction *junction, int row, int variable);
+
+  private:
+    const ElementStateStore *m_state;
+    std::vector<const ElementJunction*> m_junctions;
+    int m_size;
+    bool m_initialized;
+    bool m_assembled;
+    bool m_approximate;
+
+    //Compressed sparse row storage
+    std::vector<int> m_rowPointers;
+    std::vector<int> m_columns;
+    std::vector<double> m_values;
+    std::vector<int> m_diagonal;
+
+    //Entries of each column for the difference quotients [columnPointers[c], columnPointers[c+1])
+    std::vector<int> m_columnPointers;
+    std::vector<int> m_columnEntries;
+    std::vector<int> m_columnRows;
+
+    //Columns grouped so that no two columns of a group share a row
+    std::vector<int> m_groupPointers;
+    std::vector<int> m_groupColumns;
+
+    //Difference quotient scratch
+    std::vector<double> m_perturbedValues;
+    std::vector<double> m_perturbedDerivatives;
+    std::vector<double> m_increments;
+};
+
+#endif // TRANSPORTJACOBIAN_H
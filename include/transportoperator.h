@@ -0,0 +1,137 @@
+/*!
+*  \file    transportoperator.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#ifndef TRANSPORTOPERATOR_H
+#define TRANSPORTOPERATOR_H
+
+#include "cshcomponent_global.h"
+
+#include <vector>
+
+struct Element;
+struct ElementStateStore;
+class ElementFluxKernels;
+
+/*!
+ * \brief The TransportOperator class holds the advection and dispersion terms of the element equations
+ * as a sparse matrix in compressed sparse row format. Rows are elements and columns are elements followed
+ * by the junctions adjacent to the elements. For the Upwind, Central and Hybrid schemes these terms are linear
+ * in the transported variable once the hydraulics are fixed, so the matrix is assembled once per time step
+ * from the face groups of ElementFluxKernels and applied to temperature and all solutes in a single sweep
+ * over its nonzeros (sparse matrix times dense block). Temperature and solutes share the sparsity pattern
+ * but not the values since the dispersion term of solutes is scaled by volume instead of sol_volume.
+ */
+class CSHCOMPONENT_EXPORT TransportOperator
+{
+    friend class TransportJacobian;
+
+  public:
+
+    /*!
+     * \brief TransportOperator
+     */
+    TransportOperator();
+
+    /*!
+     * \brief initialize - Numbers the junction columns and sizes the work arrays.
+     * \param state - Element state store.
+     * \param kernels - Face flux kernels whose face groups the operator is assembled from.
+     * \param elements - Elements ordered by Element::index.
+     */
+    void initialize(const ElementStateStore *state, const ElementFluxKernels *kernels, const std::vector<Element*> &elements);
+
+    /*!
+     * \brief assemble - Assembles the operator from the current face groups.
+     * \return False if a face flux is not linear (TVD) or the solutes do not share the same faces.
+     */
+    bool assemble();
+
+    /*!
+     * \brief isAssembled
+     * \return True if the last call to assemble succeeded.
+     */
+    bool isAssembled() const;
+
+    /*!
+     * \brief apply - Computes the temperature and solute derivatives of all elements. The rows are shared by the threads
+     * of the enclosing parallel region and are not synchronized on return. Runs serially outside a parallel region.
+     * \param firstOrderK - First order reaction rate constants of the solutes (1/s).
+     * \param y - Solver state vector.
+     * \param dydt - Solver derivative vector written at the element tIndex and sIndex.
+     */
+    void apply(const std::vector<double> &firstOrderK, const double y[], double dydt[]);
+
+  private:
+
+    /*!
+     * \brief addFace - Adds the coefficients of a face flux to the assembly triplets.
+     * \param flux - ElementFluxKernels advection or dispersion flux type.
+     * \param advection - True for an advection face.
+     * \param i - Element the face flux is evaluated for.
+     * \param row - Row the coefficients are added to.
+     * \param sign - 1.0 for the element's own face and -1.0 when scattered to its upstream neighbour.
+     * \param heat - Adds to the temperature values if true and to the solute values otherwise.
+     */
+    void addFace(int flux, bool advection, int i, int row, double sign, bool heat);
+
+    /*!
+     * \brief addEntry
+     */
+    void addEntry(int row, int column, double value, bool heat);
+
+  private:
+
+    struct Triplet
+    {
+        int row;
+        int column;
+        double heatValue;
+        double soluteValue;
+    };
+
+    const ElementStateStore *m_state;
+    const ElementFluxKernels *m_kernels;
+    int m_numColumns;
+    int m_numVariables;
+    bool m_assembled;
+
+    //Junction columns of the upstream and downstream junctions of each element
+    std::vector<int> m_upstreamJunctionColumn;
+    std::vector<int> m_downstreamJunctionColumn;
+
+    //Solver index of each column for each variable [column * numVariables + variable]
+    std::vector<int> m_columnIndexes;
+
+    //Compressed sparse row storage
+    std::vector<int> m_rowPointers;
+    std::vector<int> m_columns;
+    std::vector<double> m_heatValues;
+    std::vector<double> m_soluteValues;
+
+    //Coefficients multiplying the upstream and downstream junction boundary values of each row
+    std::vector<double> m_heatUpstreamBC, m_heatDownstreamBC;
+    std::vector<double> m_soluteUpstreamBC, m_soluteDownstreamBC;
+
+    std::vector<Triplet> m_triplets;
+
+    //Gathered state block [column * numVariables + variable]
+    std::vector<double> m_x;
+};
+
+#endif // TRANSPORTOPERATOR_H
@@ -0,0 +1,92 @@
+/*!
+*  \file    treelinearsolver.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#ifndef TREELINEARSOLVER_H
+#define TREELINEARSOLVER_H
+
+#include "cshcomponent_global.h"
+
+#include <vector>
+
+class TransportJacobian;
+
+/*!
+ * \brief The TreeLinearSolver class solves the Newton systems (I - gamma * J) z = r of the implicit solver exactly
+ * in linear time when the graph of the sparse transport Jacobian is a forest, which is the case for dendritic
+ * river networks discretized with the Upwind, Central or Hybrid schemes. The unknowns are ordered so that every
+ * unknown comes after its parent and the system is eliminated from the leaves to the roots and back substituted
+ * from the roots to the leaves, a generalization of the Thomas algorithm to trees.
+ */
+class CSHCOMPONENT_EXPORT TreeLinearSolver
+{
+  public:
+
+    /*!
+     * \brief TreeLinearSolver
+     */
+    TreeLinearSolver();
+
+    /*!
+     * \brief initialize - Orders the unknowns from the roots to the leaves of the Jacobian graph.
+     * \param jacobian - Jacobian whose sparsity pattern is used.
+     * \return False if the graph has a loop, in which case the solver cannot be used.
+     */
+    bool initialize(const TransportJacobian *jacobian);
+
+    /*!
+     * \brief isTree
+     * \return True if the last call to initialize found no loop.
+     */
+    bool isTree() const;
+
+    /*!
+     * \brief factorize - Eliminates I - gamma * J using the current Jacobian values.
+     * \param gamma
+     * \return False if a zero pivot was encountered.
+     */
+    bool factorize(double gamma);
+
+    /*!
+     * \brief solve - Solves (I - gamma * J) z = r with the last factorization.
+     * \param r
+     * \param z
+     */
+    void solve(const double r[], double z[]);
+
+  private:
+    const TransportJacobian *m_jacobian;
+    bool m_isTree;
+
+    //Unknowns ordered so that parents come before their children
+    std::vector<int> m_order;
+    std::vector<int> m_parent;
+
+    //Positions of the coefficients coupling each unknown to its parent (row i, column parent) and (row parent, column i)
+    std::vector<int> m_toParentPosition;
+    std::vector<int> m_fromParentPosition;
+
+    //Eliminated pivots and the coefficients of the matrix being eliminated
+    std::vector<double> m_pivots;
+    std::vector<double> m_toParent;
+    std::vector<double> m_fromParent;
+
+    std::vector<double> m_work;
+};
+
+#endif // TREELINEARSOLVER_H
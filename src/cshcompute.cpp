@@ -24,36 +24,93 @@
 #include "iboundarycondition.h"
 #include "cshcomponent.h"
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
 
 #ifdef USE_OPENMP
 #include <omp.h>
 #endif
 
+#if defined(USE_OPENMP) && defined(__linux__)
+#include <sched.h>
+#endif
+
 
 using namespace std;
 
+//Elements per block of the heat and solute balance reduction. The blocks do not depend on the number of threads.
+static const int BALANCE_BLOCK_SIZE = 64;
+
+//Neumaier compensated summation. The running error is kept in compensation and added to sum when the total is read.
+static inline void compensatedAdd(double &sum, double &compensation, double value)
+{
+  double total = sum + value;
+  compensation += fabs(sum) >= fabs(value) ? (sum - total) + value : (value - total) + sum;
+  sum = total;
+}
+
+//Time steps run with each candidate number of threads while tuning. The fastest run of a phase is kept to filter out noise.
+static const int THREAD_TUNING_STEPS = 3;
+
+//Thread counts chosen by the tuner for models of the same size in this process
+static std::mutex threadTuningCacheMutex;
+static std::map<std::vector<int>, std::vector<int>> threadTuningCache;
+
 void CSHModel:: update()
 {
   if(m_currentDateTime < m_endDateTime)
   {
-    applyBoundaryConditions(m_currentDateTime);
+    //Continuous integration applies the forcing at the end of the time step. The forcing applied at the end of the
+    //previous time step starts the interval and computeDYDt interpolates between the two.
+    bool continuous = continuousIntegration();
+
+    m_prevTimeStep = m_timeStep;
+
+    if(continuous)
+      m_timeStep = computeTimeStep();
+
+    applyBoundaryConditions(continuous ? m_currentDateTime + m_timeStep / 86400.0 : m_currentDateTime);
 
     if(m_component)
       m_component->applyInputValues();
 
-    m_prevTimeStep = m_timeStep;
+    if(!continuous)
+      m_timeStep = computeTimeStep();
+
+    double phaseStart = threadTuningClock();
+    bool flowReversed = computeElementPhases(continuous);
+    recordPhaseTime(ElementPhases, threadTuningClock() - phaseStart);
 
-    m_timeStep = computeTimeStep();
+    m_solverDiscontinuity = m_solverDiscontinuity || flowReversed;
 
-    computeDerivedHydraulics();
+    //The face groups only change when an element switches its advection functions
+    if(m_advectionFunctionsChanged)
+    {
+      m_fluxKernels.classify(m_elements);
+      m_advectionFunctionsChanged = false;
+    }
 
-    computeLongDispersion();
+    //A jump in the forcing restarts the integration like a flow reversal does
+    if(continuous && m_elementState.updateForcingInterval(false, m_forcingDiscontinuityTolerance, m_odeSolver->absoluteTolerance()))
+    {
+      m_solverDiscontinuity = true;
+    }
 
-    computeEvaporation();
+    //The operator is frozen over the time step so it is not used when the hydraulics are solved alongside transport
+    if((m_useLinearTransportOperator || m_transportJacobian.isInitialized()) && !m_solveHydraulics)
+    {
+      m_transportOperator.assemble();
+    }
 
-    computeConvection();
+    m_transportJacobian.invalidate();
 
-    computeFluidFrictionHeat();
+    //The integrator may keep its Newton matrix across time steps so the analytic Jacobian is refreshed right away
+    if(continuous && m_transportJacobian.isInitialized())
+    {
+      m_transportJacobian.assemble(m_transportOperator);
+    }
 
     solve(m_timeStep);
 
@@ -62,7 +119,11 @@ void CSHModel:: update()
 
     prepareForNextTimeStep();
 
-    if(m_currentDateTime >= m_nextOutputTime)
+    if(m_useDenseOutput)
+    {
+      writeDenseOutput();
+    }
+    else if(m_currentDateTime >= m_nextOutputTime)
     {
       writeOutput();
       m_nextOutputTime = std::min(m_nextOutputTime + m_outputInterval / 86400.0 , m_endDateTime);
@@ -72,64 +133,398 @@ void CSHModel:: update()
     {
       printStatus();
     }
+
+    advanceThreadTuning();
   }
 }
 
-void CSHModel::prepareForNextTimeStep()
+bool CSHModel::computeElementPhases(bool checkFlowReversal)
 {
+  bool flowReversed = false;
 
-  //#ifdef USE_OPENMP
-  //#pragma omp parallel for
-  //#endif
-  for(int i = 0 ; i < (int)m_elementJunctions.size(); i++)
+  //The element phases run in one team. Their loops are orphaned work sharing directives that bind to this region
+  //and only synchronize where an element reads the results of its neighbours.
+#ifdef USE_OPENMP
+#pragma omp parallel num_threads(phaseThreads(ElementPhases))
+#endif
   {
-    ElementJunction *elementJunction = m_elementJunctions[i];
-    elementJunction->prevTemperature.copy(elementJunction->temperature);
+    //Everything an element derives from its own state and from the solved flows and areas of its neighbours is
+    //computed in one sweep so that its data is loaded once per step
+    m_subnetworkScheduler.forEachElement([this, checkFlowReversal, &flowReversed](int i)
+    {
+      Element *element = m_elements[i];
+      long advectionDispatches = element->advectionDispatchCount;
+      element->computeDerivedHydraulics();
+      element->computeLongDispersion();
+      element->computePecletNumbers();
 
-    for(size_t j = 0; j < m_solutes.size(); j++)
+      if(m_useEvaporation)
+        element->computeEvaporation();
+
+      if(m_useConvection)
+        element->computeConvection();
+
+      if(m_computeFluidFrictionHeat)
+        element->computeFluidFrictionHeat();
+
+      //A flow reversal switches the upwind faces of the right hand side
+      if(checkFlowReversal && m_elementState.flow[i] * element->flow.value < 0.0)
+      {
+#ifdef USE_OPENMP
+#pragma omp atomic write
+#endif
+        flowReversed = true;
+      }
+
+      if(element->advectionDispatchCount != advectionDispatches)
+      {
+#ifdef USE_OPENMP
+#pragma omp atomic write
+#endif
+        m_advectionFunctionsChanged = true;
+      }
+    }, true);
+
+    //The junctions and the face Peclet numbers both read the completed element sweep but not each other
+    computeJunctionDerivedHydraulics();
+
+    m_subnetworkScheduler.forEachElement([this](int i)
+    {
+      Element *element = m_elements[i];
+      element->computeUpstreamPeclet();
+      element->computeDownstreamPeclet();
+    }, false);
+
+#ifdef USE_OPENMP
+#pragma omp barrier
+#endif
+
+    m_elementState.update(m_elements);
+  }
+
+  return flowReversed;
+}
+
+void CSHModel::bindThreads()
+{
+  if(!m_useThreadBinding)
+    return;
+
+#if defined(USE_OPENMP) && defined(__linux__)
+  //The runtime already binds its threads when OMP_PROC_BIND or OMP_PLACES are set
+  if(omp_get_proc_bind() != omp_proc_bind_false)
+    return;
+
+  cpu_set_t available;
+  CPU_ZERO(&available);
+
+  if(sched_getaffinity(0, sizeof(cpu_set_t), &available))
+  {
+    printf("CSH Thread binding failed. The threads are not bound\n");
+    return;
+  }
+
+  std::vector<int> processors;
+
+  for(int c = 0; c < CPU_SETSIZE; c++)
+  {
+    if(CPU_ISSET(c, &available))
+      processors.push_back(c);
+  }
+
+  if(processors.empty())
+    return;
+
+  //Consecutive threads go to consecutive processors so that neighbouring static partitions share a memory node
+#pragma omp parallel
+  {
+    cpu_set_t processor;
+    CPU_ZERO(&processor);
+    CPU_SET(processors[omp_get_thread_num() % processors.size()], &processor);
+    sched_setaffinity(0, sizeof(cpu_set_t), &processor);
+  }
+#else
+  printf("CSH Thread binding is only supported with OpenMP on Linux. Use OMP_PROC_BIND and OMP_PLACES instead\n");
+#endif
+}
+
+void CSHModel::initializeThreadTuning()
+{
+  std::fill(m_phaseThreads, m_phaseThreads + NumParallelPhases, 0);
+  m_threadCandidates.clear();
+  m_threadTuningStep = -1;
+
+#ifdef USE_OPENMP
+  if(!m_useThreadTuning)
+    return;
+
+  int maxThreads = omp_get_max_threads();
+
+  {
+    std::lock_guard<std::mutex> lock(threadTuningCacheMutex);
+    auto it = threadTuningCache.find(threadTuningKey());
+
+    if(it != threadTuningCache.end())
     {
-      elementJunction->prevSoluteConcs[j].copy(elementJunction->soluteConcs[j]);
+      std::copy(it->second.begin(), it->second.end(), m_phaseThreads);
+      return;
     }
   }
 
-  m_minTemp = std::numeric_limits<double>::max();
-  m_maxTemp = std::numeric_limits<double>::lowest();
+  for(int numThreads = 1; numThreads < maxThreads; numThreads *= 2)
+  {
+    m_threadCandidates.push_back(numThreads);
+  }
 
-  std::fill(m_maxSolute.begin(), m_maxSolute.end(), m_maxTemp);
-  std::fill(m_minSolute.begin(), m_minSolute.end(), m_minTemp);
+  m_threadCandidates.push_back(maxThreads);
+  m_threadTuningTimes.assign(m_threadCandidates.size() * NumParallelPhases, std::numeric_limits<double>::max());
+  m_threadTuningStep = 0;
 
-  for(size_t i = 0 ; i < m_elements.size(); i++)
+  std::fill(m_phaseThreads, m_phaseThreads + NumParallelPhases, m_threadCandidates[0]);
+#endif
+}
+
+double CSHModel::threadTuningClock() const
+{
+#ifdef USE_OPENMP
+  return m_threadTuningStep > -1 ? omp_get_wtime() : 0.0;
+#else
+  return 0.0;
+#endif
+}
+
+void CSHModel::recordPhaseTime(ParallelPhase phase, double time)
+{
+  if(m_threadTuningStep > -1)
   {
-    Element *element = m_elements[i];
+    double &bestTime = m_threadTuningTimes[(m_threadTuningStep / THREAD_TUNING_STEPS) * NumParallelPhases + phase];
+    bestTime = std::min(bestTime, time);
+  }
+}
 
-    element->computeHeatBalance(m_timeStep);
-    m_totalHeatBalance += element->totalHeatBalance;
-    m_totalRadiationHeatBalance += element->totalRadiationFluxesHeatBalance;
-    m_totalAdvDispHeatBalance += element->totalAdvDispHeatBalance;
-    m_totalEvaporationHeatBalance += element->totalEvaporativeHeatFluxesBalance;
-    m_totalConvectiveHeatBalance += element->totalConvectiveHeatFluxesBalance;
-    m_totalExternalHeatFluxBalance += element->totalExternalHeatFluxesBalance;
+void CSHModel::advanceThreadTuning()
+{
+  if(m_threadTuningStep < 0)
+    return;
 
-    element->prevTemperature.copy(element->temperature);
-    element->prevFlow.copy(element->flow);
+  m_threadTuningStep++;
 
-    m_minTemp = min(m_minTemp , element->temperature.value);
-    m_maxTemp = max(m_maxTemp , element->temperature.value);
+  int candidate = m_threadTuningStep / THREAD_TUNING_STEPS;
 
-    for(size_t j = 0; j < m_solutes.size(); j++)
+  if(candidate < (int)m_threadCandidates.size())
+  {
+    std::fill(m_phaseThreads, m_phaseThreads + NumParallelPhases, m_threadCandidates[candidate]);
+    return;
+  }
+
+  //Keep the fastest thread count of each phase. Ties go to fewer threads.
+  for(int phase = 0; phase < NumParallelPhases; phase++)
+  {
+    double bestTime = std::numeric_limits<double>::max();
+    m_phaseThreads[phase] = m_threadCandidates.back();
+
+    for(size_t c = 0; c < m_threadCandidates.size(); c++)
     {
-      element->computeSoluteBalance(m_timeStep, j);
-      m_totalSoluteMassBalance[j] += element->totalSoluteMassBalance[j];
-      m_totalAdvDispSoluteMassBalance[j] += element->totalAdvDispSoluteMassBalance[j];
-      m_totalExternalSoluteFluxMassBalance[j] += element->totalExternalSoluteFluxesMassBalance[j];
+      double time = m_threadTuningTimes[c * NumParallelPhases + phase];
+
+      if(time < bestTime)
+      {
+        bestTime = time;
+        m_phaseThreads[phase] = m_threadCandidates[c];
+      }
+    }
+  }
 
-      element->prevSoluteConcs[j].copy(element->soluteConcs[j]);
+  m_threadTuningStep = -1;
+
+  std::lock_guard<std::mutex> lock(threadTuningCacheMutex);
+  threadTuningCache[threadTuningKey()] = std::vector<int>(m_phaseThreads, m_phaseThreads + NumParallelPhases);
+}
+
+std::vector<int> CSHModel::threadTuningKey() const
+{
+  int maxThreads = 1;
+
+#ifdef USE_OPENMP
+  maxThreads = omp_get_max_threads();
+#endif
 
-      m_minSolute[j] = min(m_minSolute[j] , element->soluteConcs[j].value);
-      m_maxSolute[j] = max(m_maxSolute[j] , element->soluteConcs[j].value);
+  return {maxThreads, (int)m_elements.size(), (int)m_elementJunctions.size(), m_solverSize, m_solveHydraulics};
+}
+
+int CSHModel::phaseThreads(ParallelPhase phase) const
+{
+#ifdef USE_OPENMP
+  return m_phaseThreads[phase] > 0 ? m_phaseThreads[phase] : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+void CSHModel::prepareForNextTimeStep()
+{
+  int numElements = m_elements.size();
+  int numSolutes = m_solutes.size();
+
+  //Heat terms followed by the total, advection-dispersion and external terms of each solute
+  int numTerms = 6 + 3 * numSolutes;
+  int numExtrema = 2 * (1 + numSolutes);
+  int numBlocks = (numElements + BALANCE_BLOCK_SIZE - 1) / BALANCE_BLOCK_SIZE;
+
+  m_balancePartials.resize(2 * numTerms * numBlocks);
+  m_extremaPartials.resize(numExtrema * numBlocks);
+
+  //Once the solver buffers are swapped the buffer the time step started from holds the previous values
+  bool swapped = m_solverBuffersHoldState;
+  const double *previousValues = m_solverCurrentValues.data();
+
+  if((int)m_balanceTotals.size() != 2 * numTerms)
+  {
+    m_balanceTotals.assign(2 * numTerms, 0.0);
+  }
+
+  //Each block of elements is summed in element order and the block partials are combined by a pairwise tree
+  //in a fixed order so the balances do not depend on the number of threads.
+#ifdef USE_OPENMP
+#pragma omp parallel num_threads(phaseThreads(ElementPhases))
+#endif
+  {
+    if(!swapped)
+    {
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+      for(int i = 0 ; i < (int)m_elementJunctions.size(); i++)
+      {
+        ElementJunction *elementJunction = m_elementJunctions[i];
+        elementJunction->prevTemperature.copy(elementJunction->temperature);
+
+        for(int j = 0; j < numSolutes; j++)
+        {
+          elementJunction->prevSoluteConcs[j].copy(elementJunction->soluteConcs[j]);
+        }
+      }
+    }
+
+#ifdef USE_OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(int b = 0; b < numBlocks; b++)
+    {
+      double *sums = &m_balancePartials[2 * numTerms * b];
+      double *compensations = sums + numTerms;
+      double *extrema = &m_extremaPartials[numExtrema * b];
+
+      std::fill(sums, sums + 2 * numTerms, 0.0);
+
+      for(int e = 0; e < numExtrema; e += 2)
+      {
+        extrema[e] = std::numeric_limits<double>::max();
+        extrema[e + 1] = std::numeric_limits<double>::lowest();
+      }
+
+      for(int i = b * BALANCE_BLOCK_SIZE; i < std::min(numElements, (b + 1) * BALANCE_BLOCK_SIZE); i++)
+      {
+        Element *element = m_elements[i];
+
+        element->computeHeatBalance(m_timeStep, swapped ? previousValues[element->tIndex] : element->prevTemperature.value);
+        compensatedAdd(sums[0], compensations[0], element->totalHeatBalance);
+        compensatedAdd(sums[1], compensations[1], element->totalRadiationFluxesHeatBalance);
+        compensatedAdd(sums[2], compensations[2], element->totalAdvDispHeatBalance);
+        compensatedAdd(sums[3], compensations[3], element->totalEvaporativeHeatFluxesBalance);
+        compensatedAdd(sums[4], compensations[4], element->totalConvectiveHeatFluxesBalance);
+        compensatedAdd(sums[5], compensations[5], element->totalExternalHeatFluxesBalance);
+
+        if(!swapped)
+        {
+          element->prevTemperature.copy(element->temperature);
+        }
+
+        element->prevFlow.copy(element->flow);
+
+        extrema[0] = min(extrema[0] , element->temperature.value);
+        extrema[1] = max(extrema[1] , element->temperature.value);
+
+        for(int j = 0; j < numSolutes; j++)
+        {
+          int t = 6 + 3 * j;
+
+          element->computeSoluteBalance(m_timeStep, j, swapped ? previousValues[element->sIndex[j]] : element->prevSoluteConcs[j].value);
+          compensatedAdd(sums[t], compensations[t], element->totalSoluteMassBalance[j]);
+          compensatedAdd(sums[t + 1], compensations[t + 1], element->totalAdvDispSoluteMassBalance[j]);
+          compensatedAdd(sums[t + 2], compensations[t + 2], element->totalExternalSoluteFluxesMassBalance[j]);
+
+          if(!swapped)
+          {
+            element->prevSoluteConcs[j].copy(element->soluteConcs[j]);
+          }
+
+          extrema[2 + 2 * j] = min(extrema[2 + 2 * j] , element->soluteConcs[j].value);
+          extrema[3 + 2 * j] = max(extrema[3 + 2 * j] , element->soluteConcs[j].value);
+        }
+      }
+    }
+
+    for(int stride = 1; stride < numBlocks; stride *= 2)
+    {
+#ifdef USE_OPENMP
+#pragma omp for schedule(static)
+#endif
+      for(int b = 0; b < numBlocks - stride; b += 2 * stride)
+      {
+        double *sums = &m_balancePartials[2 * numTerms * b];
+        const double *otherSums = &m_balancePartials[2 * numTerms * (b + stride)];
+        double *extrema = &m_extremaPartials[numExtrema * b];
+        const double *otherExtrema = &m_extremaPartials[numExtrema * (b + stride)];
+
+        for(int t = 0; t < numTerms; t++)
+        {
+          compensatedAdd(sums[t], sums[numTerms + t], otherSums[t]);
+          sums[numTerms + t] += otherSums[numTerms + t];
+        }
+
+        for(int e = 0; e < numExtrema; e += 2)
+        {
+          extrema[e] = min(extrema[e], otherExtrema[e]);
+          extrema[e + 1] = max(extrema[e + 1], otherExtrema[e + 1]);
+        }
+      }
     }
   }
 
+  if(numBlocks)
+  {
+    for(int t = 0; t < numTerms; t++)
+    {
+      compensatedAdd(m_balanceTotals[t], m_balanceTotals[numTerms + t], m_balancePartials[t]);
+      m_balanceTotals[numTerms + t] += m_balancePartials[numTerms + t];
+    }
+  }
+
+  m_totalHeatBalance = m_balanceTotals[0] + m_balanceTotals[numTerms];
+  m_totalRadiationHeatBalance = m_balanceTotals[1] + m_balanceTotals[numTerms + 1];
+  m_totalAdvDispHeatBalance = m_balanceTotals[2] + m_balanceTotals[numTerms + 2];
+  m_totalEvaporationHeatBalance = m_balanceTotals[3] + m_balanceTotals[numTerms + 3];
+  m_totalConvectiveHeatBalance = m_balanceTotals[4] + m_balanceTotals[numTerms + 4];
+  m_totalExternalHeatFluxBalance = m_balanceTotals[5] + m_balanceTotals[numTerms + 5];
+
+  m_minTemp = numBlocks ? m_extremaPartials[0] : std::numeric_limits<double>::max();
+  m_maxTemp = numBlocks ? m_extremaPartials[1] : std::numeric_limits<double>::lowest();
+
+  for(int j = 0; j < numSolutes; j++)
+  {
+    int t = 6 + 3 * j;
+
+    m_totalSoluteMassBalance[j] = m_balanceTotals[t] + m_balanceTotals[numTerms + t];
+    m_totalAdvDispSoluteMassBalance[j] = m_balanceTotals[t + 1] + m_balanceTotals[numTerms + t + 1];
+    m_totalExternalSoluteFluxMassBalance[j] = m_balanceTotals[t + 2] + m_balanceTotals[numTerms + t + 2];
+
+    m_minSolute[j] = numBlocks ? m_extremaPartials[2 + 2 * j] : std::numeric_limits<double>::max();
+    m_maxSolute[j] = numBlocks ? m_extremaPartials[3 + 2 * j] : std::numeric_limits<double>::lowest();
+  }
+
+  m_solverBuffersHoldState = m_useSolverBufferSwap;
+
   if(m_prevDateTime <= m_startDateTime)
   {
     for(size_t i = 0 ; i < m_elements.size(); i++)
@@ -178,6 +573,7 @@ void CSHModel::applyInitialConditions()
   std::fill(m_totalAdvDispSoluteMassBalance.begin(), m_totalAdvDispSoluteMassBalance.end(), 0.0);
   std::fill(m_totalExternalSoluteFluxMassBalance.begin(), m_totalExternalSoluteFluxMassBalance.end(), 0.0);
 
+  m_balanceTotals.clear();
 
   applyBoundaryConditions(m_currentDateTime);
 
@@ -273,54 +669,62 @@ double CSHModel::computeTimeStep()
   {
     timeStep = m_minTimeStep;
     m_numCurrentInitFixedTimeSteps++;
+    m_limitingElement = -1;
   }
   else if(m_useAdaptiveTimeStep)
   {
-#ifdef _WIN32
+    int limitingElement = -1;
+
+    //Each thread keeps the largest factor of its elements and the team combines them in a critical section. Ties go
+    //to the lowest element index so the limiting element does not depend on the number of threads.
+#ifdef USE_OPENMP
+#pragma omp parallel num_threads(phaseThreads(ElementPhases))
+#endif
     {
+      double threadMaxCourantFactor = 0.0;
+      int threadLimitingElement = -1;
 
+#ifdef USE_OPENMP
+#pragma omp for schedule(static) nowait
+#endif
       for(int i = 0 ; i < (int)m_elements.size()  ; i++)
       {
         Element *element = m_elements[i];
         double courantFactor = element->computeCourantFactor() + element->computeDispersionFactor();
 
-        if(!std::isinf(courantFactor) && courantFactor > maxCourantFactor)
+        if(!(std::isinf(courantFactor) || std::isnan(courantFactor)) && courantFactor > threadMaxCourantFactor)
         {
-          maxCourantFactor = courantFactor;
+          threadMaxCourantFactor = courantFactor;
+          threadLimitingElement = i;
         }
       }
-    }
-#else
-    {
-      //#ifdef USE_OPENMP
-      //#pragma omp parallel for
-      //#endif
-      for(int i = 0 ; i < (int)m_elements.size()  ; i++)
-      {
-        Element *element = m_elements[i];
-        double courantFactor = element->computeCourantFactor() + element->computeDispersionFactor();
 
-        if(!(std::isinf(courantFactor) || std::isnan(courantFactor)) && courantFactor > maxCourantFactor)
+#ifdef USE_OPENMP
+#pragma omp critical (CourantFactor)
+#endif
+      {
+        if(threadMaxCourantFactor > maxCourantFactor ||
+           (threadMaxCourantFactor == maxCourantFactor && threadLimitingElement > -1 && threadLimitingElement < limitingElement))
         {
-
-          //#ifdef USE_OPENMP
-          //#pragma omp atomic read
-          //#endif
-          maxCourantFactor = courantFactor;
-
+          maxCourantFactor = threadMaxCourantFactor;
+          limitingElement = threadLimitingElement;
         }
       }
     }
-#endif
+
+    m_limitingElement = limitingElement;
 
     timeStep = maxCourantFactor ? m_timeStepRelaxationFactor / maxCourantFactor : m_maxTimeStep;
   }
 
   double nextTime = m_currentDateTime + timeStep / 86400.0;
 
-  if(nextTime > m_nextOutputTime)
+  //Dense output interpolates the report times so only the end of the simulation limits the time step
+  double limitTime = m_useDenseOutput ? m_endDateTime : m_nextOutputTime;
+
+  if(nextTime > limitTime)
   {
-    timeStep = std::max(m_minTimeStep,  (m_nextOutputTime - m_currentDateTime) *  86400.0);
+    timeStep = std::max(m_minTimeStep,  (limitTime - m_currentDateTime) *  86400.0);
   }
 
   timeStep = std::min(std::max(timeStep, m_minTimeStep), m_maxTimeStep);
@@ -331,32 +735,28 @@ double CSHModel::computeTimeStep()
 void CSHModel::computeDerivedHydraulics()
 {
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp parallel num_threads(phaseThreads(ElementPhases))
 #endif
-  for(int i = 0 ; i < (int)m_elements.size(); i++)
-  {
-    Element *element = m_elements[i];
-    element->computeDerivedHydraulics();
-  }
-
-  if(m_solveHydraulics)
   {
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp for
 #endif
-    for(int i = 0 ; i < (int)m_elementJunctions.size(); i++)
-    {
-      ElementJunction *elementJunction = m_elementJunctions[i];
-      elementJunction->computeDerivedHydraulics();
-      elementJunction->computeInflow();
-    }
-  }
-  else
-  {
-    for(int i = 0 ; i < (int)m_eligibleJunctions.size(); i++)
+    for(int i = 0 ; i < (int)m_elements.size(); i++)
     {
-      m_eligibleJunctions[i]->computeDerivedHydraulics();
+      Element *element = m_elements[i];
+      long advectionDispatches = element->advectionDispatchCount;
+      element->computeDerivedHydraulics();
+
+      if(element->advectionDispatchCount != advectionDispatches)
+      {
+#ifdef USE_OPENMP
+#pragma omp atomic write
+#endif
+        m_advectionFunctionsChanged = true;
+      }
     }
+
+    computeJunctionDerivedHydraulics();
   }
 }
 
@@ -365,13 +765,12 @@ void CSHModel::computeEvaporation()
   if(m_useEvaporation)
   {
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp parallel for num_threads(phaseThreads(ElementPhases))
 #endif
-    for(int i = 0 ; i < static_cast<int>(m_elements.size()); i++)
+    for(int i = 0 ; i < (int)m_elements.size(); i++)
     {
       Element *element = m_elements[i];
       element->computeEvaporation();
-//      element->computeConvection();
     }
   }
 }
@@ -381,12 +780,11 @@ void CSHModel::computeConvection()
   if(m_useConvection)
   {
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp parallel for num_threads(phaseThreads(ElementPhases))
 #endif
     for(int i = 0 ; i < (int)m_elements.size(); i++)
     {
       Element *element = m_elements[i];
-//      element->computeEvaporation();
       element->computeConvection();
     }
   }
@@ -397,7 +795,7 @@ void CSHModel::computeFluidFrictionHeat()
   if(m_computeFluidFrictionHeat)
   {
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp parallel for num_threads(phaseThreads(ElementPhases))
 #endif
     for(int i = 0 ; i < (int)m_elements.size(); i++)
     {
@@ -407,143 +805,213 @@ void CSHModel::computeFluidFrictionHeat()
   }
 }
 
-void CSHModel::computeLongDispersion()
+void CSHModel::computeJunctionDerivedHydraulics()
 {
-#ifdef USE_OPENMP
-#pragma omp parallel for
-#endif
-  for(int i = 0 ; i < (int)m_elements.size(); i++)
+  if(m_solveHydraulics)
   {
-    Element *element = m_elements[i];
-    element->computeLongDispersion();
-  }
-
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp for nowait
 #endif
-  for(int i = 0 ; i < (int)m_elements.size(); i++)
-  {
-    Element *element = m_elements[i];
-    element->computePecletNumbers();
+    for(int i = 0 ; i < (int)m_elementJunctions.size(); i++)
+    {
+      ElementJunction *elementJunction = m_elementJunctions[i];
+      elementJunction->computeDerivedHydraulics();
+      elementJunction->computeInflow();
+    }
   }
-
+  else
+  {
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp single nowait
 #endif
-  for(int i = 0 ; i < (int)m_elements.size(); i++)
-  {
-    Element *element = m_elements[i];
-    element->computeUpstreamPeclet();
-    element->computeDownstreamPeclet();
+    for(int i = 0 ; i < (int)m_eligibleJunctions.size(); i++)
+    {
+      m_eligibleJunctions[i]->computeDerivedHydraulics();
+    }
   }
 }
 
 void CSHModel::solve(double timeStep)
 {
+  //Set initial input and output values to current values. When the solver buffers are swapped the output of the last
+  //time step already holds them. The inputs may change the cross-section areas so they are read again when the
+  //hydraulics are solved.
+  double phaseStart = threadTuningClock();
 
-  if(m_solveHydraulics)
+  if(m_solverBuffersHoldState)
   {
-#ifdef USE_OPENMP
-#pragma omp parallel for
-#endif
-    for(int i = 0 ; i < (int)m_elements.size(); i++)
-    {
-      Element *element = m_elements[i];
+    m_solverCurrentValues.swap(m_solverOutputValues);
 
-      m_solverCurrentValues[element->hIndex] = element->xSectionArea;
-      m_solverOutputValues[element->hIndex] = element->xSectionArea;
+    if(m_solveHydraulics)
+    {
+      getSolverValues(m_solverCurrentValues);
     }
   }
+  else
+  {
+    getSolverValues(m_solverCurrentValues);
+    getSolverValues(m_solverOutputValues);
+  }
 
-  //Set initial input and output values to current values.
-#ifdef USE_OPENMP
-#pragma omp parallel for
+  double solverValuesTime = threadTuningClock() - phaseStart;
+
+  //Solve using ODE solver
+  SolverUserData solverUserData; solverUserData.model = this;
+
+  bool solverFailed = false;
+  double startTime = m_solverTime;
+
+  //Save the start of a time step that passes a report time for the output interpolant
+  m_denseOutputReady = m_useDenseOutput && m_currentDateTime + timeStep / 86400.0 >= m_nextOutputTime;
+
+  if(m_denseOutputReady)
+  {
+    m_denseOutputStartValues = m_solverCurrentValues;
+    m_denseOutputStartDerivatives.resize(m_solverCurrentValues.size());
+    m_denseOutputEndDerivatives.resize(m_solverCurrentValues.size());
+    computeDYDt(startTime, m_denseOutputStartValues.data(), m_denseOutputStartDerivatives.data(), &solverUserData);
+  }
+
+#ifdef USE_CVODE
+  if(m_implicitSolver)
+  {
+    if(m_solverDiscontinuity)
+    {
+      m_implicitSolver->requestReinitialization();
+      m_solverDiscontinuity = false;
+    }
+
+    solverFailed = m_implicitSolver->solve(m_solverCurrentValues.data(), m_solverCurrentValues.size(), startTime, timeStep,
+                                           m_solverOutputValues.data(), &solverUserData);
+  }
+  else
 #endif
-  for(int i = 0 ; i < (int)m_elements.size(); i++)
   {
-    Element *element = m_elements[i];
+    solverFailed = m_variableODESolvers.size() ? !solveDecoupled(timeStep) :
+                                                 m_odeSolver->solve(m_solverCurrentValues.data(), m_solverCurrentValues.size(), 0, timeStep,
+                                                                    m_solverOutputValues.data(), &CSHModel::computeDYDt, &solverUserData);
+  }
 
-    m_solverCurrentValues[element->tIndex] = element->temperature.value;
-    m_solverOutputValues[element->tIndex] = element->temperature.value;
+  if(solverFailed)
+  {
+    m_currentDateTime = m_endDateTime;
+    printf("CSH Solver failed \n");
 
-    for(size_t j = 0; j < m_solutes.size(); j++)
+    //The output values and end derivatives of a failed step are not interpolated or set to the elements
+    m_denseOutputReady = false;
+  }
+  else
+  {
+    if(m_denseOutputReady)
     {
-      int sIndex = element->sIndex[j];
-      m_solverCurrentValues[sIndex] = element->soluteConcs[j].value;
-      m_solverOutputValues[sIndex] = element->soluteConcs[j].value;
+      computeDYDt(startTime + timeStep, m_solverOutputValues.data(), m_denseOutputEndDerivatives.data(), &solverUserData);
     }
+
+    phaseStart = threadTuningClock();
+    setSolverValues(m_solverOutputValues);
+    recordPhaseTime(SolverValuesPhase, solverValuesTime + threadTuningClock() - phaseStart);
   }
 
+  m_solverTime += timeStep;
+}
+
+void CSHModel::getSolverValues(FirstTouchVector<double> &values)
+{
+  //The loops write disjoint entries of the solver vector so they are not synchronized
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp parallel num_threads(phaseThreads(SolverValuesPhase))
 #endif
-  for(int i = 0 ; i < (int)m_eligibleJunctions.size(); i++)
   {
-    ElementJunction *elementJunction = m_eligibleJunctions[i];
-
-    if(elementJunction->junctionType == ElementJunction::MultiElement)
+    if(m_solveHydraulics)
     {
-      if(elementJunction->tIndex > -1)
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+      for(int i = 0 ; i < (int)m_elements.size(); i++)
       {
-        m_solverCurrentValues[elementJunction->tIndex] = elementJunction->temperature.value;
-        m_solverOutputValues[elementJunction->tIndex] = elementJunction->temperature.value;
+        Element *element = m_elements[i];
+        values[element->hIndex] = element->xSectionArea;
       }
+    }
+
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+    for(int i = 0 ; i < (int)m_elements.size(); i++)
+    {
+      Element *element = m_elements[i];
+      values[element->tIndex] = element->temperature.value;
 
       for(size_t j = 0; j < m_solutes.size(); j++)
       {
-        int sIndex = elementJunction->sIndex[j];
+        values[element->sIndex[j]] = element->soluteConcs[j].value;
+      }
+    }
 
-        if(sIndex > -1)
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+    for(int i = 0 ; i < (int)m_eligibleJunctions.size(); i++)
+    {
+      ElementJunction *elementJunction = m_eligibleJunctions[i];
+
+      if(elementJunction->junctionType == ElementJunction::MultiElement)
+      {
+        if(elementJunction->tIndex > -1)
         {
-          m_solverCurrentValues[sIndex] = elementJunction->soluteConcs[j].value;
-          m_solverOutputValues[sIndex] = elementJunction->soluteConcs[j].value;
+          values[elementJunction->tIndex] = elementJunction->temperature.value;
+        }
+
+        for(size_t j = 0; j < m_solutes.size(); j++)
+        {
+          int sIndex = elementJunction->sIndex[j];
+
+          if(sIndex > -1)
+          {
+            values[sIndex] = elementJunction->soluteConcs[j].value;
+          }
         }
       }
     }
   }
+}
 
-  //Solve using ODE solver
-  SolverUserData solverUserData; solverUserData.model = this;
-
-  if(m_odeSolver->solve(m_solverCurrentValues.data(), m_solverCurrentValues.size(), 0, timeStep,
-                        m_solverOutputValues.data(), &CSHModel::computeDYDt, &solverUserData))
-  {
-    m_currentDateTime = m_endDateTime;
-    printf("CSH Solver failed \n");
-  }
-  else
+void CSHModel::setSolverValues(const FirstTouchVector<double> &values)
+{
+#ifdef USE_OPENMP
+#pragma omp parallel num_threads(phaseThreads(SolverValuesPhase))
+#endif
   {
-
     if(m_solveHydraulics)
     {
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp for nowait
 #endif
       for(int i = 0 ; i < (int)m_elements.size(); i++)
       {
         Element *element = m_elements[i];
-        element->xSectionArea = m_solverOutputValues[element->hIndex];
+        element->xSectionArea = values[element->hIndex];
         element->computeHydraulicVariables();
       }
     }
 
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp for nowait
 #endif
     for(int i = 0 ; i < (int)m_elements.size(); i++)
     {
       Element *element = m_elements[i];
-      element->temperature.value = m_solverOutputValues[element->tIndex];
+      element->temperature.value = values[element->tIndex];
 
       for(size_t j = 0; j < m_solutes.size(); j++)
       {
         int sIndex = element->sIndex[j];
-        element->soluteConcs[j].value = m_solverOutputValues[sIndex];
+        element->soluteConcs[j].value = values[sIndex];
       }
     }
 
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp for nowait
 #endif
     for(int i = 0 ; i < (int)m_eligibleJunctions.size(); i++)
     {
@@ -553,7 +1021,7 @@ void CSHModel::solve(double timeStep)
       {
         if(elementJunction->tIndex > -1)
         {
-          elementJunction->temperature.value = m_solverOutputValues[elementJunction->tIndex];
+          elementJunction->temperature.value = values[elementJunction->tIndex];
         }
 
         for(size_t j = 0; j < m_solutes.size(); j++)
@@ -562,7 +1030,7 @@ void CSHModel::solve(double timeStep)
 
           if(sIndex > -1)
           {
-            elementJunction->soluteConcs[j].value = m_solverOutputValues[sIndex];
+            elementJunction->soluteConcs[j].value = values[sIndex];
           }
         }
       }
@@ -570,71 +1038,251 @@ void CSHModel::solve(double timeStep)
   }
 }
 
+bool CSHModel::continuousIntegration() const
+{
+#ifdef USE_CVODE
+  return m_implicitSolver && m_implicitSolver->isContinuous();
+#else
+  return false;
+#endif
+}
+
 void CSHModel::computeDYDt(double t, double y[], double dydt[], void* userData)
 {
   SolverUserData *solverUserData = (SolverUserData*) userData;
   CSHModel *modelInstance = solverUserData->model;
 
-  if(modelInstance->m_solveHydraulics)
+  //CVODE may step past tout and interpolate back. The forcing is then held at the end of the interval.
+  if(modelInstance->continuousIntegration())
   {
+    double weight = (t - modelInstance->m_solverTime) / modelInstance->m_timeStep;
+    modelInstance->m_elementState.interpolateForcing(std::min(std::max(weight, 0.0), 1.0));
+  }
 
+  double phaseStart = modelInstance->threadTuningClock();
+
+  //One parallel region per evaluation. The phases share their loops through orphaned work sharing
+  //directives and only synchronize where a phase reads what the previous one wrote.
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp parallel num_threads(modelInstance->phaseThreads(RightHandSidePhase))
 #endif
-    for(int i = 0 ; i < (int)modelInstance->m_elements.size(); i++)
+  {
+    if(modelInstance->m_solveHydraulics)
     {
-      Element *element = modelInstance->m_elements[i];
-      element->calculateQfromA(y);
+      modelInstance->m_subnetworkScheduler.forEachElement([modelInstance, y](int i)
+      {
+        Element *element = modelInstance->m_elements[i];
+        element->calculateQfromA(y);
+        modelInstance->m_elementState.updateHydraulics(element);
+      }, true);
+
+      //Junction inflows only read the element flows computed above so the junctions are independent of each other
+#ifdef USE_OPENMP
+#pragma omp for
+#endif
+      for(int i = 0; i < (int)modelInstance->m_elementJunctions.size(); i++)
+      {
+        ElementJunction *elementJunction = modelInstance->m_elementJunctions[i];
+        elementJunction->computeInflow();
+      }
+
+      modelInstance->m_subnetworkScheduler.forEachElement([modelInstance, t, y, dydt](int i)
+      {
+        Element *element = modelInstance->m_elements[i];
+        dydt[element->hIndex] = element->computeDADt(t,y);
+      }, false);
     }
 
-    for(int i = 0; i < (int)modelInstance->m_elementJunctions.size(); i++)
+    if(modelInstance->m_useLinearTransportOperator && modelInstance->m_transportOperator.isAssembled())
     {
-      ElementJunction *elementJunction = modelInstance->m_elementJunctions[i];
-      elementJunction->computeInflow();
+      modelInstance->m_transportOperator.apply(modelInstance->m_solute_first_order_k, y, dydt);
+    }
+    else
+    {
+      modelInstance->m_fluxKernels.computeDerivatives(modelInstance->m_solute_first_order_k, y, dydt);
     }
-
 
 #ifdef USE_OPENMP
-#pragma omp parallel for
+#pragma omp for nowait
 #endif
-    for(int i = 0 ; i < (int)modelInstance->m_elements.size(); i++)
+    for(int i = 0 ; i < (int)modelInstance->m_eligibleJunctions.size(); i++)
     {
-      Element *element = modelInstance->m_elements[i];
-      dydt[element->hIndex] = element->computeDADt(t,y);
+      ElementJunction *elementJunction = modelInstance->m_eligibleJunctions[i];
+
+      if(elementJunction->junctionType == ElementJunction::MultiElement)
+      {
+        dydt[elementJunction->tIndex] = elementJunction->computeDTDt(t,y);
+
+        for(size_t j = 0; j < modelInstance->m_solutes.size(); j++)
+        {
+          dydt[elementJunction->sIndex[j]] = elementJunction->computeDSoluteDt(t, y, j);
+        }
+      }
     }
   }
 
+  modelInstance->recordPhaseTime(RightHandSidePhase, modelInstance->threadTuningClock() - phaseStart);
+}
+
+void CSHModel::computeJacobian(double t, double y[], double fy[], void *userData)
+{
+  SolverUserData *solverUserData = (SolverUserData*) userData;
+  CSHModel *modelInstance = solverUserData->model;
+  TransportJacobian &jacobian = modelInstance->m_transportJacobian;
+
+  //The analytic Jacobian only changes with the hydraulics
+  if(jacobian.isAssembled() && !jacobian.isApproximate())
+    return;
+
+  if(!jacobian.assemble(modelInstance->m_transportOperator))
+  {
+    jacobian.assemble(&CSHModel::computeDYDt, userData, t, y, fy);
+  }
+}
+
+void CSHModel::computeJacobianTimesVector(double t, double v[], double Jv[], void *userData)
+{
+  SolverUserData *solverUserData = (SolverUserData*) userData;
+  solverUserData->model->m_transportJacobian.multiply(v, Jv);
+}
+
+bool CSHModel::setupPreconditioner(double t, double y[], double fy[], bool jacobianCurrent, double gamma, void *userData)
+{
+  SolverUserData *solverUserData = (SolverUserData*) userData;
+  CSHModel *modelInstance = solverUserData->model;
+
+  if(!modelInstance->m_transportJacobian.isAssembled())
+  {
+    computeJacobian(t, y, fy, userData);
+  }
+
+  return modelInstance->m_treeLinearSolver.isTree() ? modelInstance->m_treeLinearSolver.factorize(gamma) :
+                                                      modelInstance->m_reachBlockPreconditioner.factorize(gamma);
+}
+
+void CSHModel::solvePreconditioner(double t, double r[], double z[], double gamma, void *userData)
+{
+  SolverUserData *solverUserData = (SolverUserData*) userData;
+  CSHModel *modelInstance = solverUserData->model;
+
+  if(modelInstance->m_treeLinearSolver.isTree())
+  {
+    modelInstance->m_treeLinearSolver.solve(r, z);
+  }
+  else
+  {
+    modelInstance->m_reachBlockPreconditioner.solve(r, z);
+  }
+}
+
+bool CSHModel::solveDecoupled(double timeStep)
+{
+  int numVariables = m_variableODESolvers.size();
+  bool solverFailed = false;
+
+  m_decoupledSolverValues = m_solverCurrentValues;
+
+  //The threads are split between the variables. Each solve evaluates its right hand side in a nested team of its
+  //share of the threads so a run with fewer variables than threads still uses all of them.
+  int numThreads = phaseThreads(RightHandSidePhase);
+  int numSolves = std::max(1, std::min(numVariables, numThreads));
+
+  m_variableSolverThreads.resize(numVariables);
+
+  for(int v = 0; v < numVariables; v++)
+  {
+    m_variableSolverThreads[v] = numVariables >= numThreads ? 1 : numThreads / numSolves + (v < numThreads % numSolves ? 1 : 0);
+  }
+
 #ifdef USE_OPENMP
-#pragma omp parallel for
+  int maxActiveLevels = omp_get_max_active_levels();
+  omp_set_max_active_levels(std::max(maxActiveLevels, 2));
 #endif
-  for(int i = 0 ; i < (int)modelInstance->m_elements.size(); i++)
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numSolves)
+#endif
+  for(int v = 0; v < numVariables; v++)
   {
-    Element *element = modelInstance->m_elements[i];
-    dydt[element->tIndex] = element->computeDTDt(t,y);
+    int offset = m_variableSolverOffsets[v];
+    int variableSize = m_variableSolverOffsets[v + 1] - offset;
+
+    SolverUserData solverUserData; solverUserData.model = this; solverUserData.variableIndex = v;
 
-    for(size_t j = 0; j < modelInstance->m_solutes.size(); j++)
+    if(m_variableODESolvers[v]->solve(m_solverCurrentValues.data() + offset, variableSize, 0, timeStep,
+                                      m_solverOutputValues.data() + offset, &CSHModel::computeVariableDYDt, &solverUserData))
     {
-      dydt[element->sIndex[j]] = element->computeDSoluteDt(t, y, j);
+#ifdef USE_OPENMP
+#pragma omp atomic write
+#endif
+      solverFailed = true;
     }
   }
 
 #ifdef USE_OPENMP
-#pragma omp parallel for
+  omp_set_max_active_levels(maxActiveLevels);
+#endif
+
+  return !solverFailed;
+}
+
+void CSHModel::computeVariableDYDt(double t, double y[], double dydt[], void *userData)
+{
+  SolverUserData *solverUserData = (SolverUserData*) userData;
+  CSHModel *modelInstance = solverUserData->model;
+  int v = solverUserData->variableIndex;
+  int offset = modelInstance->m_variableSolverOffsets[v];
+  int variableSize = modelInstance->m_variableSolverOffsets[v + 1] - offset;
+
+  //Variable blocks are disjoint so each solve only touches its own block of the shared full size vectors
+  double *values = modelInstance->m_decoupledSolverValues.data();
+  double *derivatives = modelInstance->m_decoupledSolverDerivatives.data();
+  std::copy(y, y + variableSize, values + offset);
+
+  //Nested team of the threads solveDecoupled assigned to this variable
+#ifdef USE_OPENMP
+#pragma omp parallel num_threads(modelInstance->m_variableSolverThreads[v])
 #endif
-  for(int i = 0 ; i < (int)modelInstance->m_eligibleJunctions.size(); i++)
   {
-    ElementJunction *elementJunction = modelInstance->m_eligibleJunctions[i];
+    if(v == 0)
+    {
+      modelInstance->m_fluxKernels.computeDTDt(values, derivatives);
 
-    if(elementJunction->junctionType == ElementJunction::MultiElement)
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+      for(int i = 0 ; i < (int)modelInstance->m_eligibleJunctions.size(); i++)
+      {
+        ElementJunction *elementJunction = modelInstance->m_eligibleJunctions[i];
+
+        if(elementJunction->junctionType == ElementJunction::MultiElement && elementJunction->tIndex > -1)
+        {
+          derivatives[elementJunction->tIndex] = elementJunction->computeDTDt(t, values);
+        }
+      }
+    }
+    else
     {
-      dydt[elementJunction->tIndex] = elementJunction->computeDTDt(t,y);
+      int j = v - 1;
 
-      for(size_t j = 0; j < modelInstance->m_solutes.size(); j++)
+      modelInstance->m_fluxKernels.computeDSoluteDt(j, modelInstance->m_solute_first_order_k[j], values, derivatives);
+
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+      for(int i = 0 ; i < (int)modelInstance->m_eligibleJunctions.size(); i++)
       {
-        dydt[elementJunction->sIndex[j]] = elementJunction->computeDSoluteDt(t, y, j);
+        ElementJunction *elementJunction = modelInstance->m_eligibleJunctions[i];
+
+        if(elementJunction->junctionType == ElementJunction::MultiElement && elementJunction->sIndex[j] > -1)
+        {
+          derivatives[elementJunction->sIndex[j]] = elementJunction->computeDSoluteDt(t, values, j);
+        }
       }
     }
   }
+
+  std::copy(derivatives + offset, derivatives + offset + variableSize, dydt);
 }
 
 void CSHModel::solveJunctionContinuity(double timeStep)
@@ -26,6 +26,9 @@
 #include "spatial/edge.h"
 #include "iboundarycondition.h"
 
+#include <algorithm>
+#include <unordered_set>
+
 using namespace std;
 
 CSHModel::CSHModel(CSHComponent *component)
@@ -70,6 +73,7 @@ CSHModel::~CSHModel()
     delete element;
 
   m_elements.clear();
+  m_inputOrderElements.clear();
   m_elementsById.clear();
 
 
@@ -77,10 +81,20 @@ CSHModel::~CSHModel()
     delete elementJunction;
 
   m_elementJunctions.clear();
+  m_inputOrderElementJunctions.clear();
   m_elementJunctionsById.clear();
 
   delete m_odeSolver;
 
+  for(ODESolver *odeSolver : m_variableODESolvers)
+    delete odeSolver;
+
+  m_variableODESolvers.clear();
+
+#ifdef USE_CVODE
+  delete m_implicitSolver;
+#endif
+
   closeOutputFiles();
 
   m_timeSeries.clear();
@@ -310,6 +324,7 @@ ElementJunction *CSHModel::addElementJunction(const string &id, double x, double
     ElementJunction *eJunction = new ElementJunction(id, x, y, z, this);
     eJunction->tIndex = m_elementJunctions.size();
     m_elementJunctions.push_back(eJunction);
+    m_inputOrderElementJunctions.push_back(eJunction);
     m_elementJunctionsById[id] = eJunction;
     return eJunction;
   }
@@ -332,13 +347,19 @@ void CSHModel::deleteElementJunction(const string &id)
       m_elementJunctions.erase(it);
     }
 
+    it = std::find(m_inputOrderElementJunctions.begin(), m_inputOrderElementJunctions.end(), eJunction);
+    if(it != m_inputOrderElementJunctions.end())
+    {
+      m_inputOrderElementJunctions.erase(it);
+    }
+
     delete eJunction;
   }
 }
 
 void CSHModel::deleteElementJunction(int index)
 {
-  ElementJunction *eJunction = m_elementJunctions[index];
+  ElementJunction *eJunction = m_inputOrderElementJunctions[index];
 
   m_elementJunctionsById.erase(eJunction->id);
 
@@ -346,6 +367,8 @@ void CSHModel::deleteElementJunction(int index)
   if(it != m_elementJunctions.end())
     m_elementJunctions.erase(it);
 
+  m_inputOrderElementJunctions.erase(m_inputOrderElementJunctions.begin() + index);
+
   delete eJunction;
 }
 
@@ -356,7 +379,7 @@ ElementJunction *CSHModel::getElementJunction(const string &id)
 
 ElementJunction *CSHModel::getElementJunction(int index)
 {
-  return m_elementJunctions[index];
+  return m_inputOrderElementJunctions[index];
 }
 
 int CSHModel::numElements() const
@@ -371,6 +394,7 @@ Element *CSHModel::addElement(const string &id, ElementJunction *upStream, Eleme
     Element *element = new Element(id, upStream, downStream, this);
     element->tIndex = m_elements.size();
     m_elements.push_back(element);
+    m_inputOrderElements.push_back(element);
     m_elementsById[id] = element;
     return element;
   }
@@ -391,13 +415,17 @@ void CSHModel::deleteElement(const string &id)
     if(it != m_elements.end())
       m_elements.erase(it);
 
+    it = std::find(m_inputOrderElements.begin() , m_inputOrderElements.end(), element);
+    if(it != m_inputOrderElements.end())
+      m_inputOrderElements.erase(it);
+
     delete element;
   }
 }
 
 void CSHModel::deleteElement(int index)
 {
-  Element *element = m_elements[index];
+  Element *element = m_inputOrderElements[index];
   m_elementJunctionsById.erase(element->id);
 
   vector<Element*>::iterator it = std::find(m_elements.begin() , m_elements.end(), element);
@@ -405,6 +433,8 @@ void CSHModel::deleteElement(int index)
   if(it != m_elements.end())
     m_elements.erase(it);
 
+  m_inputOrderElements.erase(m_inputOrderElements.begin() + index);
+
   delete element;
 }
 
@@ -415,7 +445,7 @@ Element *CSHModel::getElement(const string &id)
 
 Element *CSHModel::getElement(int index)
 {
-  return m_elements[index];
+  return m_inputOrderElements[index];
 }
 
 RetrieveCouplingData CSHModel::retrieveCouplingDataFunction() const
@@ -445,6 +475,8 @@ bool CSHModel::initialize(list<string> &errors)
 
     applyInitialConditions();
 
+    initializeThreadTuning();
+
   }
 
   return initialized;
@@ -501,6 +533,10 @@ bool CSHModel::initializeTimeVariables(std::list<string> &errors)
 
 bool CSHModel::initializeElements(std::list<string> &errors)
 {
+  //Bind the threads before they first touch the element state
+  bindThreads();
+
+  reorderElements();
 
 #ifdef USE_OPENMP
 #pragma omp parallel for
@@ -529,74 +565,137 @@ bool CSHModel::initializeElements(std::list<string> &errors)
 
   }
 
+  buildJunctionAdjacency();
+
   m_solverSize = 0;
 
-  if(m_solveHydraulics)
+  if(m_useInterleavedSolverLayout)
   {
+    //Element major: the variables of each element and then of each junction are consecutive
     for(int i = 0 ; i < (int)m_elements.size()  ; i++)
     {
       Element *element = m_elements[i];
-      element->hIndex = m_solverSize; m_solverSize++;
-      element->distanceFromUpStreamJunction = 0;
+      element->index = i;
+
+      if(m_solveHydraulics)
+      {
+        element->hIndex = m_solverSize; m_solverSize++;
+        element->distanceFromUpStreamJunction = 0;
+      }
+      else
+      {
+        element->hIndex = -1;
+      }
+
+      element->tIndex = m_solverSize; m_solverSize++;
+
+      for(size_t j = 0 ; j < m_solutes.size(); j++)
+      {
+        element->sIndex[j] = m_solverSize; m_solverSize++;
+      }
+
+      element->initialize();
     }
-  }
-  else
-  {
-    for(int i = 0 ; i < (int)m_elements.size()  ; i++)
+
+    for(size_t i = 0 ; i < m_elementJunctions.size()  ; i++)
     {
-      Element *element = m_elements[i];
-      element->hIndex = -1;
-    }
-  }
+      ElementJunction *elementJunction = m_elementJunctions[i];
 
+      if(elementJunction->junctionType == ElementJunction::MultiElement)
+      {
+        if(!elementJunction->temperature.isBC)
+        {
+          elementJunction->tIndex = m_solverSize; m_solverSize++;
+        }
+        else
+        {
+          elementJunction->tIndex = -1;
+        }
 
-  for(int i = 0 ; i < (int)m_elements.size()  ; i++)
-  {
-    Element *element = m_elements[i];
-    element->tIndex = m_solverSize; m_solverSize++;
-    element->initialize();
+        for(size_t j = 0 ; j < m_solutes.size(); j++)
+        {
+          if(!elementJunction->soluteConcs[j].isBC)
+          {
+            elementJunction->sIndex[j] = m_solverSize; m_solverSize++;
+          }
+          else
+          {
+            elementJunction->sIndex[j] = -1;
+          }
+        }
+      }
+    }
   }
-
-
-  for(size_t i = 0 ; i < m_elementJunctions.size()  ; i++)
+  else
   {
-    ElementJunction *elementJunction = m_elementJunctions[i];
-
-    if(elementJunction->junctionType == ElementJunction::MultiElement)
+    if(m_solveHydraulics)
     {
-      if(!elementJunction->temperature.isBC)
+      for(int i = 0 ; i < (int)m_elements.size()  ; i++)
       {
-        elementJunction->tIndex = m_solverSize; m_solverSize++;
+        Element *element = m_elements[i];
+        element->hIndex = m_solverSize; m_solverSize++;
+        element->distanceFromUpStreamJunction = 0;
       }
-      else
+    }
+    else
+    {
+      for(int i = 0 ; i < (int)m_elements.size()  ; i++)
       {
-        elementJunction->tIndex = -1;
+        Element *element = m_elements[i];
+        element->hIndex = -1;
       }
     }
-  }
 
-  for(size_t j = 0 ; j < m_solutes.size(); j++)
-  {
+
     for(int i = 0 ; i < (int)m_elements.size()  ; i++)
     {
       Element *element = m_elements[i];
-      element->sIndex[j] = m_solverSize; m_solverSize++;
+      element->index = i;
+      element->tIndex = m_solverSize; m_solverSize++;
+      element->initialize();
     }
 
+
     for(size_t i = 0 ; i < m_elementJunctions.size()  ; i++)
     {
       ElementJunction *elementJunction = m_elementJunctions[i];
 
       if(elementJunction->junctionType == ElementJunction::MultiElement)
       {
-        if(!elementJunction->soluteConcs[j].isBC)
+        if(!elementJunction->temperature.isBC)
         {
-          //If more than one junction solve continuity
-          elementJunction->sIndex[j] = m_solverSize; m_solverSize++;;
+          elementJunction->tIndex = m_solverSize; m_solverSize++;
         }
         else
         {
-          elementJunction->sIndex[j] = -1;
+          elementJunction->tIndex = -1;
+        }
+      }
+    }
+
+    for(size_t j = 0 ; j < m_solutes.size(); j++)
+    {
+      for(int i = 0 ; i < (int)m_elements.size()  ; i++)
+      {
+        Element *element = m_elements[i];
+        element->sIndex[j] = m_solverSize; m_solverSize++;
+      }
+
+      for(size_t i = 0 ; i < m_elementJunctions.size()  ; i++)
+      {
+        ElementJunction *elementJunction = m_elementJunctions[i];
+
+        if(elementJunction->junctionType == ElementJunction::MultiElement)
+        {
+          if(!elementJunction->soluteConcs[j].isBC)
+          {
+            //If more than one junction solve continuity
+            elementJunction->sIndex[j] = m_solverSize; m_solverSize++;;
+          }
+          else
+          {
+            elementJunction->sIndex[j] = -1;
+          }
         }
       }
     }
@@ -630,6 +729,11 @@ bool CSHModel::initializeElements(std::list<string> &errors)
     calculateDistanceFromUpstreamJunction(m_elements[i]);
   }
 
+  m_elementState.initialize(m_elements, m_solutes.size());
+  m_fluxKernels.initialize(&m_elementState, m_useFaceFluxAssembly);
+  m_advectionFunctionsChanged = true;
+  m_subnetworkScheduler.initialize(&m_elementState, m_useSubnetworkTasks);
+  m_transportOperator.initialize(&m_elementState, &m_fluxKernels, m_elements);
 
   return true;
 }
@@ -646,12 +750,116 @@ bool CSHModel::initializeSolver(std::list<string> &errors)
   //    totalCells += m_elements.size();
   //  }
 
-  m_solverCurrentValues.resize(m_solverSize, 0.0);
-  m_solverOutputValues.resize(m_solverSize, 0.0);
+  //Each thread first touches the solver values of the elements it copies in getSolverValues
+  FirstTouchVector<double>(m_solverSize).swap(m_solverCurrentValues);
+  FirstTouchVector<double>(m_solverSize).swap(m_solverOutputValues);
+  getSolverValues(m_solverCurrentValues);
+  getSolverValues(m_solverOutputValues);
+  m_solverBuffersHoldState = false;
 
   m_odeSolver->setSize(m_solverSize);
   m_odeSolver->initialize();
 
+  for(ODESolver *odeSolver : m_variableODESolvers)
+    delete odeSolver;
+
+  m_variableODESolvers.clear();
+  m_variableSolverOffsets.clear();
+
+  if(m_useDecoupledSolves && m_solveHydraulics)
+  {
+    printf("CSH Decoupled variable solves require prescribed flows. Solving all the variables together\n");
+  }
+  else if(m_useDecoupledSolves && m_useInterleavedSolverLayout)
+  {
+    printf("CSH Decoupled variable solves require the variable major solver layout. Solving all the variables together\n");
+  }
+
+  //Hydraulics couple all the variables so they can only be solved decoupled when the flows are prescribed.
+  //Each decoupled solver integrates a contiguous range of the solver vector, which needs the variable major layout.
+  if(m_useDecoupledSolves && !m_solveHydraulics && !m_useInterleavedSolverLayout && m_elements.size())
+  {
+    firstTouchAssign(m_decoupledSolverValues, m_solverSize, 0.0);
+    firstTouchAssign(m_decoupledSolverDerivatives, m_solverSize, 0.0);
+
+    m_variableSolverOffsets.push_back(m_elements[0]->tIndex);
+
+    for(size_t j = 0; j < m_solutes.size(); j++)
+    {
+      m_variableSolverOffsets.push_back(m_elements[0]->sIndex[j]);
+    }
+
+    m_variableSolverOffsets.push_back(m_solverSize);
+
+    for(size_t v = 0; v < m_variableSolverOffsets.size() - 1; v++)
+    {
+      int variableSize = m_variableSolverOffsets[v + 1] - m_variableSolverOffsets[v];
+
+      ODESolver *odeSolver = new ODESolver(variableSize, m_odeSolver->solverType());
+      odeSolver->setSolverIterationMethod(m_odeSolver->solverType() == ODESolver::CVODE_BDF ?
+                                            ODESolver::IterationMethod::NEWTON :
+                                            ODESolver::IterationMethod::FUNCTIONAL);
+      odeSolver->setLinearSolverType(m_odeSolver->linearSolverType());
+      odeSolver->setAbsoluteTolerance(m_odeSolver->absoluteTolerance());
+      odeSolver->setRelativeTolerance(m_odeSolver->relativeTolerance());
+      odeSolver->initialize();
+
+      m_variableODESolvers.push_back(odeSolver);
+    }
+  }
+
+#ifdef USE_CVODE
+  delete m_implicitSolver;
+  m_implicitSolver = nullptr;
+  m_solverTime = 0.0;
+
+  if(m_odeSolver->solverType() == ODESolver::CVODE_BDF && !m_solveHydraulics && m_variableODESolvers.empty())
+  {
+    m_transportJacobian.initialize(&m_elementState, m_eligibleJunctions, m_solverSize, m_advectionMode == AdvectionDiscretizationMode::TVD);
+
+    m_implicitSolver = new ImplicitTransportSolver(m_solverSize, m_odeSolver->linearSolverType());
+    m_implicitSolver->setTolerances(m_odeSolver->absoluteTolerance(), m_odeSolver->relativeTolerance());
+    m_implicitSolver->setMaxIterations(m_odeSolver->maxIterations());
+    m_implicitSolver->setFunctions(&CSHModel::computeDYDt, &CSHModel::computeJacobian, &CSHModel::computeJacobianTimesVector);
+
+    bool useTreeLinearSolver = m_useTreeLinearSolver && m_treeLinearSolver.initialize(&m_transportJacobian);
+
+    //Networks with loops keep the Krylov linear solver preconditioned by the reaches
+    if(m_useTreeLinearSolver && !useTreeLinearSolver)
+    {
+      printf("CSH Tree linear solver requires a network without loops. Using the reach block preconditioned Krylov linear solver\n");
+    }
+
+    if(!useTreeLinearSolver && (m_useTreeLinearSolver || m_useReachBlockPreconditioner))
+    {
+      m_reachBlockPreconditioner.initialize(&m_transportJacobian, &m_elementState);
+    }
+
+    if(m_useTreeLinearSolver || m_useReachBlockPreconditioner)
+    {
+      m_implicitSolver->setPreconditioner(&CSHModel::setupPreconditioner, &CSHModel::solvePreconditioner);
+    }
+
+    //The TVD element functions read the boundary values of the elements, which are not interpolated over the time step
+    m_implicitSolver->setContinuous(m_useContinuousIntegration && m_advectionMode != AdvectionDiscretizationMode::TVD);
+
+    if(!m_implicitSolver->initialize())
+    {
+      errors.push_back("Implicit transport solver could not be initialized");
+      return false;
+    }
+  }
+#endif
+
+  if(m_useContinuousIntegration && m_advectionMode == AdvectionDiscretizationMode::TVD)
+  {
+    printf("CSH Continuous integration does not support the TVD advection scheme. Restarting the solver every time step\n");
+  }
+  else if(m_useContinuousIntegration && !continuousIntegration())
+  {
+    printf("CSH Continuous integration requires the CVODE_BDF solver with prescribed flows. Restarting the solver every time step\n");
+  }
+
   return true;
 }
 
@@ -668,6 +876,123 @@ bool CSHModel::initializeBoundaryConditions(std::list<string> &errors)
   return true;
 }
 
+void CSHModel::buildJunctionAdjacency()
+{
+  size_t size = 0;
+
+  for(ElementJunction *elementJunction : m_elementJunctions)
+  {
+    size += elementJunction->incomingElements.size() + elementJunction->outgoingElements.size();
+  }
+
+  m_junctionElements.assign(size, nullptr);
+
+  Element **junctionElements = m_junctionElements.data();
+
+  for(ElementJunction *elementJunction : m_elementJunctions)
+  {
+    elementJunction->incoming.first = elementJunction->incoming.last = junctionElements;
+    junctionElements += elementJunction->incomingElements.size();
+
+    elementJunction->outgoing.first = elementJunction->outgoing.last = junctionElements;
+    junctionElements += elementJunction->outgoingElements.size();
+  }
+
+  //Filling in element order makes the iteration order independent of the addresses in the sets
+  for(Element *element : m_elements)
+  {
+    *element->downstreamJunction->incoming.last++ = element;
+    *element->upstreamJunction->outgoing.last++ = element;
+  }
+}
+
+void CSHModel::reorderElements()
+{
+  m_elements = m_inputOrderElements;
+  m_elementJunctions = m_inputOrderElementJunctions;
+
+  if(!m_useElementReordering)
+    return;
+
+  int numElements = m_inputOrderElements.size();
+
+  //Input position of each element so that the walk does not depend on the addresses in the junction sets
+  for(int i = 0; i < numElements; i++)
+  {
+    m_inputOrderElements[i]->index = i;
+  }
+
+  vector<Element*> upstreamElements;
+  vector<bool> visited(numElements, false);
+  vector<pair<Element*, size_t>> stack;
+
+  m_elements.clear();
+  m_elements.reserve(numElements);
+
+  //Depth first walk up the drainage tree from the outlets. Elements are placed after all their upstream elements so
+  //each unbranched reach is consecutive and tributaries are placed just before the confluence they join at.
+  //Elements left over by closed loops are started from in input order in the second pass.
+  for(int pass = 0; pass < 2; pass++)
+  {
+    for(int i = 0; i < numElements; i++)
+    {
+      Element *start = m_inputOrderElements[i];
+
+      if(visited[start->index] || (pass == 0 && start->downstreamJunction->outgoingElements.size()))
+        continue;
+
+      visited[start->index] = true;
+      stack.push_back(make_pair(start, 0));
+
+      while(stack.size())
+      {
+        Element *element = stack.back().first;
+        size_t next = stack.back().second++;
+
+        upstreamElements.assign(element->upstreamJunction->incomingElements.begin(), element->upstreamJunction->incomingElements.end());
+        std::sort(upstreamElements.begin(), upstreamElements.end(), [](Element *a, Element *b){ return a->index < b->index; });
+
+        while(next < upstreamElements.size() && visited[upstreamElements[next]->index])
+        {
+          next = ++stack.back().second;
+        }
+
+        if(next < upstreamElements.size())
+        {
+          Element *upstream = upstreamElements[next];
+          visited[upstream->index] = true;
+          stack.push_back(make_pair(upstream, 0));
+        }
+        else
+        {
+          m_elements.push_back(element);
+          stack.pop_back();
+        }
+      }
+    }
+  }
+
+  //Junctions follow the first element that joins them. Junctions without elements keep their input order at the end.
+  unordered_set<ElementJunction*> placed;
+  m_elementJunctions.clear();
+  m_elementJunctions.reserve(m_inputOrderElementJunctions.size());
+
+  for(Element *element : m_elements)
+  {
+    if(placed.insert(element->upstreamJunction).second)
+      m_elementJunctions.push_back(element->upstreamJunction);
+
+    if(placed.insert(element->downstreamJunction).second)
+      m_elementJunctions.push_back(element->downstreamJunction);
+  }
+
+  for(ElementJunction *elementJunction : m_inputOrderElementJunctions)
+  {
+    if(placed.insert(elementJunction).second)
+      m_elementJunctions.push_back(elementJunction);
+  }
+}
+
 bool CSHModel::findProfile(Element *from, Element *to, std::vector<Element *> &profile)
 {
   if(from == to)
@@ -677,7 +1002,7 @@ bool CSHModel::findProfile(Element *from, Element *to, std::vector<Element *> &p
   }
   else
   {
-    for(Element *outgoing : from->downstreamJunction->outgoingElements)
+    for(Element *outgoing : from->downstreamJunction->outgoing)
     {
       if(outgoing == to)
       {
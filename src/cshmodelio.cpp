@@ -112,8 +112,47 @@ void CSHModel::printStatus()
   if (m_currentPrintCount >= m_printFrequency)
   {
 
+    int iterations = m_odeSolver->getIterations();
+    int maxIterations = m_odeSolver->maxIterations();
+
+    //Report the slowest variable when the variables are solved decoupled
+    for(ODESolver *odeSolver : m_variableODESolvers)
+    {
+      iterations = std::max(iterations, odeSolver->getIterations());
+      maxIterations = odeSolver->maxIterations();
+    }
+
+#ifdef USE_CVODE
+    if(m_implicitSolver)
+    {
+      iterations = m_implicitSolver->getIterations();
+      maxIterations = m_implicitSolver->maxIterations();
+    }
+#endif
+
     printf("CSH TimeStep (s): %f\tDateTime: %f\tIters: %i/%i\tTemp (°C) { Min: %f\tMax: %f\tTotalHeatBalance: %g (KJ)}", m_timeStep, m_currentDateTime,
-           m_odeSolver->getIterations(), m_odeSolver->maxIterations(), m_minTemp, m_maxTemp, m_totalHeatBalance);
+           iterations, maxIterations, m_minTemp, m_maxTemp, m_totalHeatBalance);
+
+    if(m_useAdaptiveTimeStep && m_limitingElement > -1 && m_limitingElement < (int)m_elements.size())
+    {
+      printf("\tLimitingElement: %s", m_elements[m_limitingElement]->id.c_str());
+    }
+
+    //Times the advection functions of the elements were set again after a change of flow direction or Peclet regime
+    long advectionDispatches = 0;
+
+    for(Element *element : m_elements)
+    {
+      advectionDispatches += element->advectionDispatchCount;
+    }
+
+    printf("\tAdvectionDispatches: %li", advectionDispatches);
+
+    if(m_useThreadTuning)
+    {
+      printf("\tThreads { Elements: %i\tRHS: %i\tSolverValues: %i}", phaseThreads(ElementPhases),
+             phaseThreads(RightHandSidePhase), phaseThreads(SolverValuesPhase));
+    }
 
     for (size_t j = 0; j < m_solutes.size(); j++)
     {
@@ -368,7 +407,7 @@ bool CSHModel::initializeNetCDFOutputFile(list<string> &errors)
 
 
     //Add element junctions
-    ThreadSafeNcDim junctionDim =  m_outputNetCDF->addDim("element_junctions", m_elementJunctions.size());
+    ThreadSafeNcDim junctionDim =  m_outputNetCDF->addDim("element_junctions", m_inputOrderElementJunctions.size());
 
     ThreadSafeNcVar junctionIdentifiers =  m_outputNetCDF->addVar("element_junction_id", NcType::nc_STRING, junctionDim);
     junctionIdentifiers.putAtt("long_name", "Element Junction Identifiers");
@@ -389,18 +428,18 @@ bool CSHModel::initializeNetCDFOutputFile(list<string> &errors)
     junctionZ.putAtt("units", "m");
     m_outNetCDFVariables["z"] = junctionZ;
 
-    float *vertx = new float[m_elementJunctions.size()];
-    float *verty = new float[m_elementJunctions.size()];
-    float *vertz = new float[m_elementJunctions.size()];
-    char **junctionIds = new char *[m_elementJunctions.size()];
+    float *vertx = new float[m_inputOrderElementJunctions.size()];
+    float *verty = new float[m_inputOrderElementJunctions.size()];
+    float *vertz = new float[m_inputOrderElementJunctions.size()];
+    char **junctionIds = new char *[m_inputOrderElementJunctions.size()];
 
     //write other relevant junction attributes here.
 #ifdef USE_OPENMP
 #pragma omp parallel for
 #endif
-    for (int i = 0; i < (int)m_elementJunctions.size(); i++)
+    for (int i = 0; i < (int)m_inputOrderElementJunctions.size(); i++)
     {
-      ElementJunction *junction = m_elementJunctions[i];
+      ElementJunction *junction = m_inputOrderElementJunctions[i];
 
       junctionIds[i] = new char[junction->id.size() + 1];
       strcpy(junctionIds[i], junction->id.c_str());
@@ -419,7 +458,7 @@ bool CSHModel::initializeNetCDFOutputFile(list<string> &errors)
     delete[] verty;
     delete[] vertz;
 
-    for (size_t i = 0; i < m_elementJunctions.size(); i++)
+    for (size_t i = 0; i < m_inputOrderElementJunctions.size(); i++)
     {
       delete[] junctionIds[i];
     }
@@ -427,7 +466,7 @@ bool CSHModel::initializeNetCDFOutputFile(list<string> &errors)
     delete[] junctionIds;
 
     //Add Elements
-    ThreadSafeNcDim elementsDim =  m_outputNetCDF->addDim("elements", m_elements.size());
+    ThreadSafeNcDim elementsDim =  m_outputNetCDF->addDim("elements", m_inputOrderElements.size());
 
     ThreadSafeNcVar elementIdentifiers =  m_outputNetCDF->addVar("element_id", NcType::nc_STRING, elementsDim);
     elementIdentifiers.putAtt("long_name", "Element Identifier");
@@ -459,19 +498,19 @@ bool CSHModel::initializeNetCDFOutputFile(list<string> &errors)
     //    m_outNetCDFVariables["elements"] = elementsVar;
 
 
-    int *fromJunctions = new int[m_elements.size()];
-    int *toJunctions = new int[m_elements.size()];
-    char **elementIds = new char *[m_elements.size()];
-    float *elX = new float[m_elements.size()];
-    float *elY = new float[m_elements.size()];
-    //    double *els = new double[m_elements.size()];
+    int *fromJunctions = new int[m_inputOrderElements.size()];
+    int *toJunctions = new int[m_inputOrderElements.size()];
+    char **elementIds = new char *[m_inputOrderElements.size()];
+    float *elX = new float[m_inputOrderElements.size()];
+    float *elY = new float[m_inputOrderElements.size()];
+    //    double *els = new double[m_inputOrderElements.size()];
 
 #ifdef USE_OPENMP
 #pragma omp parallel for
 #endif
-    for (int i = 0; i < (int)m_elements.size(); i++)
+    for (int i = 0; i < (int)m_inputOrderElements.size(); i++)
     {
-      Element *element = m_elements[i];
+      Element *element = m_inputOrderElements[i];
 
       elementIds[i] = new char[element->id.size() + 1];
       strcpy(elementIds[i], element->id.c_str());
@@ -497,7 +536,7 @@ bool CSHModel::initializeNetCDFOutputFile(list<string> &errors)
     delete[] elY;
     //    delete[] els;
 
-    for (size_t i = 0; i < m_elements.size(); i++)
+    for (size_t i = 0; i < m_inputOrderElements.size(); i++)
     {
       delete[] elementIds[i];
     }
@@ -512,11 +551,11 @@ bool CSHModel::initializeNetCDFOutputFile(list<string> &errors)
     lengthVar.putAtt("units", "m");
     m_outNetCDFVariables["length"] = lengthVar;
 
-    std::vector<float> lengths(m_elements.size());
+    std::vector<float> lengths(m_inputOrderElements.size());
 
-    for(size_t i = 0; i < m_elements.size(); i++)
+    for(size_t i = 0; i < m_inputOrderElements.size(); i++)
     {
-      lengths[i] = static_cast<float>(m_elements[i]->length);
+      lengths[i] = static_cast<float>(m_inputOrderElements[i]->length);
     }
 
     lengthVar.putVar(lengths.data());
@@ -2053,6 +2092,8 @@ bool CSHModel::readInputFileOptionTag(const QString &line, QString &errorMessage
             if (it != m_linearSolverTypeFlags.end())
               linearSolver = it->second;
 
+            m_useTreeLinearSolver = linearSolver == 6;
+
             switch (linearSolver)
             {
               case 1:
@@ -2070,6 +2111,10 @@ bool CSHModel::readInputFileOptionTag(const QString &line, QString &errorMessage
               case 5:
                 m_odeSolver->setLinearSolverType(ODESolver::LinearSolverType::PCG);
                 break;
+              case 6:
+                //Krylov solver used when the network has loops
+                m_odeSolver->setLinearSolverType(ODESolver::LinearSolverType::GMRES);
+                break;
               default:
                 foundError = true;
                 break;
@@ -2130,6 +2175,280 @@ bool CSHModel::readInputFileOptionTag(const QString &line, QString &errorMessage
           }
         }
         break;
+      case 35:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useFaceFluxAssembly = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Face flux assembly tag";
+            return false;
+          }
+        }
+        break;
+      case 36:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useLinearTransportOperator = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Linear transport operator tag";
+            return false;
+          }
+        }
+        break;
+      case 37:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useDecoupledSolves = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Decoupled variable solves tag";
+            return false;
+          }
+        }
+        break;
+      case 38:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useReachBlockPreconditioner = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Reach block preconditioner tag";
+            return false;
+          }
+        }
+        break;
+      case 39:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useContinuousIntegration = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Continuous integration tag";
+            return false;
+          }
+        }
+        break;
+      case 40:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useDenseOutput = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Dense output tag";
+            return false;
+          }
+        }
+        break;
+      case 41:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useSubnetworkTasks = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Subnetwork tasks tag";
+            return false;
+          }
+        }
+        break;
+      case 42:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useThreadTuning = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Thread tuning tag";
+            return false;
+          }
+        }
+        break;
+      case 43:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useThreadBinding = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Thread binding tag";
+            return false;
+          }
+        }
+        break;
+      case 44:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useElementReordering = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Element reordering tag";
+            return false;
+          }
+        }
+        break;
+      case 45:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useInterleavedSolverLayout = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Interleaved solver layout tag";
+            return false;
+          }
+        }
+        break;
+      case 46:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2 )
+          {
+            m_useSolverBufferSwap = QString::compare(options[1], "No", Qt::CaseInsensitive) && QString::compare(options[1], "False", Qt::CaseInsensitive);
+          }
+          else
+          {
+            foundError = true;
+          }
+
+
+          if (foundError)
+          {
+            errorMessage = "Swap solver buffers tag";
+            return false;
+          }
+        }
+        break;
+      case 47:
+        {
+          bool foundError = false;
+
+          if (options.size() == 2)
+          {
+            bool ok;
+            m_forcingDiscontinuityTolerance = options[1].toDouble(&ok);
+            foundError = !ok || m_forcingDiscontinuityTolerance < 0;
+          }
+          else
+          {
+            foundError = true;
+          }
+
+          if (foundError)
+          {
+            errorMessage = "Forcing discontinuity tolerance error";
+            return false;
+          }
+        }
+        break;
     }
   }
 
@@ -3045,13 +3364,68 @@ void CSHModel::writeOutput()
   writeNetCDFOutput();
 }
 
+void CSHModel::writeDenseOutput()
+{
+  if(!m_denseOutputReady)
+  {
+    if(m_currentDateTime >= m_nextOutputTime)
+    {
+      writeOutput();
+      m_nextOutputTime = std::min(m_nextOutputTime + m_outputInterval / 86400.0 , m_endDateTime);
+    }
+
+    return;
+  }
+
+  double currentDateTime = m_currentDateTime;
+  double h = m_timeStep;
+  m_denseOutputValues.resize(m_solverOutputValues.size());
+
+  while(currentDateTime >= m_nextOutputTime)
+  {
+    double outputTime = m_outputInterval > 0.0 ? m_nextOutputTime : currentDateTime;
+    double theta = std::min(std::max((outputTime - m_prevDateTime) / (currentDateTime - m_prevDateTime), 0.0), 1.0);
+
+    //Cubic Hermite basis functions
+    double h00 = (1.0 + 2.0 * theta) * (1.0 - theta) * (1.0 - theta);
+    double h10 = theta * (1.0 - theta) * (1.0 - theta);
+    double h01 = theta * theta * (3.0 - 2.0 * theta);
+    double h11 = theta * theta * (theta - 1.0);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(phaseThreads(SolverValuesPhase))
+#endif
+    for(int i = 0; i < (int)m_denseOutputValues.size(); i++)
+    {
+      m_denseOutputValues[i] = h00 * m_denseOutputStartValues[i] + h10 * h * m_denseOutputStartDerivatives[i] +
+                               h01 * m_solverOutputValues[i] + h11 * h * m_denseOutputEndDerivatives[i];
+    }
+
+    setSolverValues(m_denseOutputValues);
+    m_currentDateTime = outputTime;
+
+    writeOutput();
+
+    bool lastOutput = outputTime >= m_endDateTime || m_outputInterval <= 0.0;
+    m_nextOutputTime = std::min(outputTime + m_outputInterval / 86400.0 , m_endDateTime);
+
+    if(lastOutput)
+      break;
+  }
+
+  //Only reached after a successful solve so the output values are the end of the time step
+  m_currentDateTime = currentDateTime;
+  setSolverValues(m_solverOutputValues);
+  m_denseOutputReady = false;
+}
+
 void CSHModel::writeCSVOutput()
 {
   if (m_outputCSVStream.device() && m_outputCSVStream.device()->isOpen())
   {
-    for (size_t i = 0; i < m_elements.size(); i++)
+    for (size_t i = 0; i < m_inputOrderElements.size(); i++)
     {
-      Element *element = m_elements[i];
+      Element *element = m_inputOrderElements[i];
 
       m_outputCSVStream << m_currentDateTime << ", " << QString::fromStdString(element->id) << ", " << element->tIndex
                         << ", " << element->x << ", " << element->y << ", " << element->z
@@ -3104,7 +3478,7 @@ void CSHModel::writeNetCDFOutput()
     for (int i = 0; i < nVars; i++)
     {
       std::string varName = m_optionalOutputVariables[static_cast<size_t>(i)];
-      (m_outNetCDFVariablesIOFunctions[varName])(currentTime, m_outNetCDFVariables[varName], m_elements);
+      (m_outNetCDFVariablesIOFunctions[varName])(currentTime, m_outNetCDFVariables[varName], m_inputOrderElements);
     }
 
     if(m_outNetCDFVariablesOnOff["total_heat_balance"])
@@ -3248,6 +3622,19 @@ const unordered_map<string, int> CSHModel::m_optionsFlags({
                                                             {"LINEAR_SOLVER", 32},
                                                             {"SOLVE_HYDRAULICS", 33},
                                                             {"FLUID_FRICTION_HEAT", 34},
+                                                            {"FACE_FLUX_ASSEMBLY", 35},
+                                                            {"LINEAR_TRANSPORT_OPERATOR", 36},
+                                                            {"DECOUPLED_VARIABLE_SOLVES", 37},
+                                                            {"REACH_BLOCK_PRECONDITIONER", 38},
+                                                            {"CONTINUOUS_INTEGRATION", 39},
+                                                            {"DENSE_OUTPUT", 40},
+                                                            {"SUBNETWORK_TASKS", 41},
+                                                            {"THREAD_TUNING", 42},
+                                                            {"THREAD_BINDING", 43},
+                                                            {"ELEMENT_REORDERING", 44},
+                                                            {"INTERLEAVED_SOLVER_LAYOUT", 45},
+                                                            {"SWAP_SOLVER_BUFFERS", 46},
+                                                            {"FORCING_DISCONTINUITY_TOLERANCE", 47},
                                                           });
 
 const unordered_map<string, int> CSHModel::m_advectionFlags({
@@ -3268,7 +3655,8 @@ const unordered_map<string, int> CSHModel::m_linearSolverTypeFlags({{"GMRES", 1}
                                                                     {"FGMRES", 2},
                                                                     {"Bi_CGStab", 3},
                                                                     {"TFQMR", 4},
-                                                                    {"PCG", 5}
+                                                                    {"PCG", 5},
+                                                                    {"TREE", 6}
                                                                    });
 
 const unordered_map<string, int> CSHModel::m_hydraulicVariableFlags({{"DEPTH", 1},
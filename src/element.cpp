@@ -25,13 +25,24 @@
 #include "elementadvcentral.h"
 #include "elementadvhybrid.h"
 #include "elementadvtvd.h"
+#include "elementstatestore.h"
 
 #include <math.h>
 
 using namespace std;
 
+//Class of a face Peclet number in the branches of ElementAdvHybrid::setAdvectionFunction
+static int pecletRegime(double pecletNumber, bool positiveFlow)
+{
+  if(fabs(pecletNumber - 0.0) < std::numeric_limits<double>::epsilon())
+    return 0;
+
+  return (positiveFlow ? pecletNumber < 2.0 : pecletNumber > -2.0) ? 1 : 2;
+}
+
 Element::Element(const std::string &id, ElementJunction *upstream, ElementJunction *downstream,  CSHModel *model)
-  : id(id),
+  : index(-1),
+    id(id),
     numSolutes(0),
     soluteConcs(nullptr),
     prevSoluteConcs(nullptr),
@@ -67,6 +78,12 @@ Element::Element(const std::string &id, ElementJunction *upstream, ElementJuncti
     pecletNumber(0.0),
     upstreamElement(nullptr),
     downstreamElement(nullptr),
+    upstreamDistance(0.0),
+    downstreamDistance(0.0),
+    upstreamNeighbourWeight(0.0),
+    upstreamCenterWeight(1.0),
+    downstreamNeighbourWeight(0.0),
+    downstreamCenterWeight(1.0),
     model(model),
     downstreamPecletNumber(1.0),
     downstreamFlow(0.0),
@@ -76,7 +93,9 @@ Element::Element(const std::string &id, ElementJunction *upstream, ElementJuncti
     computeTempAdvDeriv(nullptr),
     computeSoluteAdvDeriv(nullptr),
     computeTempDispDeriv(nullptr),
-    computeSoluteDispDeriv(nullptr)
+    computeSoluteDispDeriv(nullptr),
+    currentAdvectionRegime(-1),
+    advectionDispatchCount(0)
 {
   starting = true;
 
@@ -89,25 +108,21 @@ Element::Element(const std::string &id, ElementJunction *upstream, ElementJuncti
   y = (upstream->y +  downstream->y) / 2.0;
   z = (upstream->z +  downstream->z) / 2.0;
 
-  computeTempAdvDeriv  = new ComputeTempAdvDeriv[2]();
-  computeTempDispDeriv = new ComputeTempDeriv[2]();
+  computeTempAdvDeriv  = model->m_arena.allocate<ComputeTempAdvDeriv>(2);
+  computeTempDispDeriv = model->m_arena.allocate<ComputeTempDeriv>(2);
 
-  sideSlopes = new double[2]();
+  sideSlopes = model->m_arena.allocate<double>(2);
   externalFlows = 0.0;
 }
 
 Element::~Element()
 {
 
+  //The arrays of the element belong to the arena of the model
   deleteSoluteVariables();
 
-  delete[] sideSlopes;
-
   upstreamJunction->outgoingElements.erase(this);
   downstreamJunction->incomingElements.erase(this);
-
-  delete[] computeTempAdvDeriv;
-  delete[] computeTempDispDeriv;
 }
 
 void Element::initialize()
@@ -116,7 +131,7 @@ void Element::initialize()
   setUpstreamElement();
   setDownStreamElement();
 
-  slope = max(0.00001, fabs(upstreamJunction->z - downstreamJunction->z) / length);
+  computeGeometricCoefficients();
 
   switch (model->m_advectionMode)
   {
@@ -183,6 +198,10 @@ void Element::initialize()
   setDispersionFunctions();
   (*setAdvectionFuctions)(this);
 
+  //Boundary conditions and solver indexes are assigned after the elements so the first time step sets the functions again
+  currentAdvectionRegime = -1;
+  advectionDispatchCount = 0;
+
   if(model->m_solveHydraulics)
   {
     depth = getHofQ(flow.value);
@@ -196,23 +215,30 @@ void Element::initializeSolutes()
 
   deleteSoluteVariables();
 
+  currentAdvectionRegime = -1;
+
   if(model->m_solutes.size() > 0)
   {
     numSolutes = model->m_solutes.size();
-    soluteConcs = new Variable[numSolutes];
-    prevSoluteConcs = new Variable[numSolutes];
-    externalSoluteFluxes = new double[numSolutes];
-    totalSoluteMassBalance = new double[numSolutes]();
-    totalAdvDispSoluteMassBalance = new double[numSolutes]();
-    totalExternalSoluteFluxesMassBalance = new double[numSolutes]();
-    sIndex = new int[numSolutes]();
-    computeSoluteAdvDeriv  = new ComputeSoluteAdvDeriv*[numSolutes]();
-    computeSoluteDispDeriv = new ComputeSoluteDeriv*[numSolutes]();
+
+    ModelArena &arena = model->m_arena;
+    soluteConcs = arena.allocate<Variable>(numSolutes);
+    prevSoluteConcs = arena.allocate<Variable>(numSolutes);
+    externalSoluteFluxes = arena.allocate<double>(numSolutes);
+    totalSoluteMassBalance = arena.allocate<double>(numSolutes);
+    totalAdvDispSoluteMassBalance = arena.allocate<double>(numSolutes);
+    totalExternalSoluteFluxesMassBalance = arena.allocate<double>(numSolutes);
+    sIndex = arena.allocate<int>(numSolutes);
+    computeSoluteAdvDeriv  = arena.allocate<ComputeSoluteAdvDeriv*>(numSolutes);
+    computeSoluteDispDeriv = arena.allocate<ComputeSoluteDeriv*>(numSolutes);
+
+    ComputeSoluteAdvDeriv *soluteAdvDeriv = arena.allocate<ComputeSoluteAdvDeriv>(2 * numSolutes);
+    ComputeSoluteDeriv *soluteDispDeriv = arena.allocate<ComputeSoluteDeriv>(2 * numSolutes);
 
     for(int i = 0; i < numSolutes; i++)
     {
-      computeSoluteAdvDeriv[i] = new ComputeSoluteAdvDeriv[2]();
-      computeSoluteDispDeriv[i] = new ComputeSoluteDeriv[2]();
+      computeSoluteAdvDeriv[i] = soluteAdvDeriv + 2 * i;
+      computeSoluteDispDeriv[i] = soluteDispDeriv + 2 * i;
     }
   }
 }
@@ -357,9 +383,10 @@ void Element::computeHydraulicVariables()
 
 double Element::computeDTDt(double dt, double T[])
 {
+  const ElementStateStore &state = model->m_elementState;
   double DTDt = 0.0;
 
-  if(volume > 1e-12)
+  if(state.volume[index] > 1e-12)
   {
     //Compute advection
     DTDt += computeDTDtAdv(dt, T);
@@ -367,22 +394,12 @@ double Element::computeDTDt(double dt, double T[])
     //Compute dispersion
     DTDt += computeDTDtDispersion(dt, T);
 
-    //Add external sources
-    {
-      DTDt += radiationFluxes * top_area / rho_cp_vol;
-      DTDt += externalHeatFluxes / rho_cp_vol;
-    }
-
-    //Evaporation, convection, fluid friction
-    {
-      DTDt += evaporationHeatFlux * top_area / rho_cp_vol;
-      DTDt += convectionHeatFlux * top_area / rho_cp_vol;
-      DTDt +=  fluidFrictionHeatFlux * top_area / rho_cp_vol;
-    }
+    //External sources, evaporation, convection, fluid friction
+    DTDt += state.heatSources[index];
 
     //Product rule subtract volume derivative
     {
-      DTDt -= T[tIndex] * dvolume_dt.value / volume;
+      DTDt -= T[state.tIndex[index]] * state.dvolume_dt[index] / state.volume[index];
     }
   }
 
@@ -399,7 +416,7 @@ double Element::computeDTDtAdv(double dt, double T[])
   //Downstream
   DTDt += (*computeTempAdvDeriv[1])(this, dt, T);
 
-  DTDt = DTDt / rho_cp_vol;
+  DTDt = DTDt / model->m_elementState.rho_cp_vol[index];
 
   return DTDt;
 }
@@ -414,61 +431,69 @@ double Element::computeDTDtDispersion(double dt, double T[])
   //Downstream
   DTDt += (this->*(computeTempDispDeriv[1]))(dt, T);
 
-  DTDt = DTDt / rho_cp_vol;
+  DTDt = DTDt / model->m_elementState.rho_cp_vol[index];
 
   return DTDt;
 }
 
 double Element::computeDTDtDispersionUpstreamJunction(double dt, double T[])
 {
-  double DTDt = upstreamLongDispersion * upstreamXSectionArea * rho_cp *
-                (T[upstreamJunction->tIndex] - T[tIndex]) /
-      (length / 2.0);
+  const ElementStateStore &state = model->m_elementState;
+
+  double DTDt = state.upstreamLongDispersion[index] * state.upstreamXSectionArea[index] * state.rho_cp[index] *
+                (T[upstreamJunction->tIndex] - T[state.tIndex[index]]) * state.inverseHalfLength[index];
 
   return DTDt;
 }
 
 double Element::computeDTDtDispersionUpstreamJunctionBC(double dt, double T[])
 {
-  double DTDt = upstreamLongDispersion * upstreamXSectionArea * rho_cp *
-                (upstreamJunction->temperature.value - T[tIndex]) /
-                (length / 2.0);
+  const ElementStateStore &state = model->m_elementState;
+
+  double DTDt = state.upstreamLongDispersion[index] * state.upstreamXSectionArea[index] * state.rho_cp[index] *
+                (upstreamJunction->temperature.value - T[state.tIndex[index]]) * state.inverseHalfLength[index];
 
   return DTDt;
 }
 
 double Element::computeDTDtDispersionUpstreamNeighbour(double dt, double T[])
 {
-  double DTDt = upstreamLongDispersion * upstreamXSectionArea * rho_cp *
-                (T[upstreamElement->tIndex]  - T[tIndex]) /
-      ((length / 2.0) + (upstreamElement->length / 2.0));
+  const ElementStateStore &state = model->m_elementState;
+  int up = state.upstreamElement[index];
+
+  double DTDt = state.upstreamLongDispersion[index] * state.upstreamXSectionArea[index] * state.rho_cp[index] *
+                (T[state.tIndex[up]]  - T[state.tIndex[index]]) * state.upstreamInverseDistance[index];
 
   return DTDt;
 }
 
 double Element::computeDTDtDispersionDownstreamJunction(double dt, double T[])
 {
-  double DTDt = downstreamLongDispersion * downstreamXSectionArea * rho_cp *
-                (T[downstreamJunction->tIndex]  - T[tIndex]) /
-      (length / 2.0);
+  const ElementStateStore &state = model->m_elementState;
+
+  double DTDt = state.downstreamLongDispersion[index] * state.downstreamXSectionArea[index] * state.rho_cp[index] *
+                (T[downstreamJunction->tIndex]  - T[state.tIndex[index]]) * state.inverseHalfLength[index];
 
   return DTDt;
 }
 
 double Element::computeDTDtDispersionDownstreamJunctionBC(double dt, double T[])
 {
-  double DTDt = downstreamLongDispersion * downstreamXSectionArea * rho_cp *
-                (downstreamJunction->temperature.value  - T[tIndex]) /
-                (length / 2.0);
+  const ElementStateStore &state = model->m_elementState;
+
+  double DTDt = state.downstreamLongDispersion[index] * state.downstreamXSectionArea[index] * state.rho_cp[index] *
+                (downstreamJunction->temperature.value  - T[state.tIndex[index]]) * state.inverseHalfLength[index];
 
   return DTDt;
 }
 
 double Element::computeDTDtDispersionDownstreamNeighbour(double dt, double T[])
 {
-  double DTDt = downstreamLongDispersion * downstreamXSectionArea * rho_cp *
-                (T[downstreamElement->tIndex]  - T[tIndex]) /
-      ((length / 2.0) + (downstreamElement->length / 2.0));
+  const ElementStateStore &state = model->m_elementState;
+  int down = state.downstreamElement[index];
+
+  double DTDt = state.downstreamLongDispersion[index] * state.downstreamXSectionArea[index] * state.rho_cp[index] *
+                (T[state.tIndex[down]]  - T[state.tIndex[index]]) * state.downstreamInverseDistance[index];
 
   return DTDt;
 }
@@ -511,9 +536,10 @@ void Element::computeFluidFrictionHeat()
 
 double Element::computeDSoluteDt(double dt, double S[], int soluteIndex)
 {
+  const ElementStateStore &state = model->m_elementState;
   double DSoluteDt = 0;
 
-  if(volume > 1e-18)
+  if(state.volume[index] > 1e-18)
   {
     //Compute advection
     DSoluteDt += computeDSoluteDtAdv(dt, S, soluteIndex);
@@ -526,12 +552,12 @@ double Element::computeDSoluteDt(double dt, double S[], int soluteIndex)
 
     //subtract chain rule volume derivative
     {
-      DSoluteDt -= (S[sIndex[soluteIndex]] * dvolume_dt.value) / sol_volume;
+      DSoluteDt -= (S[state.sIndex[soluteIndex][index]] * state.dvolume_dt[index]) / state.sol_volume[index];
     }
 
     //Add external sources
     {
-      DSoluteDt += externalSoluteFluxes[soluteIndex] / sol_volume;
+      DSoluteDt += externalSoluteFluxes[soluteIndex] / state.sol_volume[index];
     }
   }
 
@@ -548,7 +574,7 @@ double Element::computeDSoluteDtAdv(double dt, double S[], int soluteIndex)
   //Downstream
   DSoluteDt += (*computeSoluteAdvDeriv[soluteIndex][1])(this, dt, S, soluteIndex);
 
-  DSoluteDt = DSoluteDt / sol_volume;
+  DSoluteDt = DSoluteDt / model->m_elementState.sol_volume[index];
 
   return DSoluteDt;
 }
@@ -564,61 +590,71 @@ double Element::computeDSoluteDtDispersion(double dt, double S[], int soluteInde
   DSoluteDt += (this->*computeSoluteDispDeriv[soluteIndex][1])(dt, S, soluteIndex);
 
 
-  DSoluteDt = DSoluteDt / volume;
+  DSoluteDt = DSoluteDt / model->m_elementState.volume[index];
 
   return DSoluteDt;
 }
 
 double Element::computeDSoluteDtDispersionUpstreamJunction(double dt, double S[], int soluteIndex)
 {
-  double DSoluteDt = upstreamLongDispersion * upstreamXSectionArea *
-                     (S[upstreamJunction->sIndex[soluteIndex]] - S[sIndex[soluteIndex]]) /
-      (length / 2.0);
+  const ElementStateStore &state = model->m_elementState;
+
+  double DSoluteDt = state.upstreamLongDispersion[index] * state.upstreamXSectionArea[index] *
+                     (S[upstreamJunction->sIndex[soluteIndex]] - S[state.sIndex[soluteIndex][index]]) * state.inverseHalfLength[index];
 
   return DSoluteDt;
 }
 
 double Element::computeDSoluteDtDispersionUpstreamJunctionBC(double dt, double S[], int soluteIndex)
 {
-  double DSoluteDt = upstreamLongDispersion * upstreamXSectionArea *
-                     (upstreamJunction->soluteConcs[soluteIndex].value - S[sIndex[soluteIndex]]) /
-      (length / 2.0);
+  const ElementStateStore &state = model->m_elementState;
+
+  double DSoluteDt = state.upstreamLongDispersion[index] * state.upstreamXSectionArea[index] *
+                     (upstreamJunction->soluteConcs[soluteIndex].value - S[state.sIndex[soluteIndex][index]]) * state.inverseHalfLength[index];
 
   return DSoluteDt;
 }
 
 double Element::computeDSoluteDtDispersionUpstreamNeighbour(double dt, double S[], int soluteIndex)
 {
-  double DSoluteDt = upstreamLongDispersion * upstreamXSectionArea *
-                     (S[upstreamElement->sIndex[soluteIndex]]  - S[sIndex[soluteIndex]]) /
-      ((length / 2.0) + (upstreamElement->length / 2.0));
+  const ElementStateStore &state = model->m_elementState;
+  const int *sIndexes = state.sIndex[soluteIndex].data();
+  int up = state.upstreamElement[index];
+
+  double DSoluteDt = state.upstreamLongDispersion[index] * state.upstreamXSectionArea[index] *
+                     (S[sIndexes[up]]  - S[sIndexes[index]]) * state.upstreamInverseDistance[index];
 
   return DSoluteDt;
 }
 
 double Element::computeDSoluteDtDispersionDownstreamJunction(double dt, double S[], int soluteIndex)
 {
-  double DSoluteDt = downstreamLongDispersion * downstreamXSectionArea *
-                     (S[downstreamJunction->sIndex[soluteIndex]]  - S[sIndex[soluteIndex]]) /
-      (length / 2.0);
+  const ElementStateStore &state = model->m_elementState;
+
+  double DSoluteDt = state.downstreamLongDispersion[index] * state.downstreamXSectionArea[index] *
+                     (S[downstreamJunction->sIndex[soluteIndex]]  - S[state.sIndex[soluteIndex][index]]) * state.inverseHalfLength[index];
 
   return DSoluteDt;
 }
 
 double Element::computeDSoluteDtDispersionDownstreamJunctionBC(double dt, double S[], int soluteIndex)
 {
-  double DSoluteDt = downstreamLongDispersion * downstreamXSectionArea *
-                     (downstreamJunction->soluteConcs[soluteIndex].value  - S[sIndex[soluteIndex]]) /
-      (length / 2.0);
+  const ElementStateStore &state = model->m_elementState;
+
+  double DSoluteDt = state.downstreamLongDispersion[index] * state.downstreamXSectionArea[index] *
+                     (downstreamJunction->soluteConcs[soluteIndex].value  - S[state.sIndex[soluteIndex][index]]) * state.inverseHalfLength[index];
 
   return DSoluteDt;
 }
 
 double Element::computeDSoluteDtDispersionDownstreamNeighbour(double dt, double S[], int soluteIndex)
 {
-  double DSoluteDt = downstreamLongDispersion * downstreamXSectionArea *
-                     (S[downstreamElement->sIndex[soluteIndex]]  - S[sIndex[soluteIndex]]) /
-      ((length / 2.0) +  (downstreamElement->length / 2.0));
+  const ElementStateStore &state = model->m_elementState;
+  const int *sIndexes = state.sIndex[soluteIndex].data();
+  int down = state.downstreamElement[index];
+
+  double DSoluteDt = state.downstreamLongDispersion[index] * state.downstreamXSectionArea[index] *
+                     (S[sIndexes[down]]  - S[sIndexes[index]]) * state.downstreamInverseDistance[index];
 
   return DSoluteDt;
 }
@@ -740,6 +776,41 @@ double Element::computeDispersionFactor() const
   return 2.0 * longDispersion.value / (length * length);
 }
 
+void Element::computeGeometricCoefficients()
+{
+  slope = max(0.00001, fabs(upstreamJunction->z - downstreamJunction->z) / length);
+
+  double centerFactor = 1.0 / (length * 0.5);
+
+  if(upstreamElement != nullptr)
+  {
+    double neighbourFactor = 1.0 / (upstreamElement->length * 0.5);
+    upstreamNeighbourWeight = neighbourFactor / (neighbourFactor + centerFactor);
+    upstreamCenterWeight = centerFactor / (neighbourFactor + centerFactor);
+    upstreamDistance = length / 2.0 + upstreamElement->length / 2.0;
+  }
+  else
+  {
+    upstreamNeighbourWeight = 0.0;
+    upstreamCenterWeight = 1.0;
+    upstreamDistance = length / 2.0;
+  }
+
+  if(downstreamElement != nullptr)
+  {
+    double neighbourFactor = 1.0 / (downstreamElement->length * 0.5);
+    downstreamNeighbourWeight = neighbourFactor / (neighbourFactor + centerFactor);
+    downstreamCenterWeight = centerFactor / (neighbourFactor + centerFactor);
+    downstreamDistance = length / 2.0 + downstreamElement->length / 2.0;
+  }
+  else
+  {
+    downstreamNeighbourWeight = 0.0;
+    downstreamCenterWeight = 1.0;
+    downstreamDistance = length / 2.0;
+  }
+}
+
 void Element::computeDerivedHydraulics()
 {
 
@@ -758,19 +829,15 @@ void Element::computeDerivedHydraulics()
 
   if(upstreamElement != nullptr)
   {
-    upstreamFlow =  ((upstreamElement->flow.value  * upstreamElementDirection  / (upstreamElement->length * 0.5)) +
-                     (flow.value  / (length * 0.5))) /
-                    ((1.0 / (upstreamElement->length * 0.5)) + (1.0 / (length * 0.5)));
+    upstreamFlow = upstreamElement->flow.value * upstreamElementDirection * upstreamNeighbourWeight +
+                   flow.value * upstreamCenterWeight;
 
-    upstreamVelocity =  (((upstreamElement->flow.value  / upstreamElement->xSectionArea )* upstreamElementDirection  / (upstreamElement->length * 0.5)) +
-                         ((flow.value  / xSectionArea) / (length * 0.5))) /
-                        ((1.0 / (upstreamElement->length * 0.5)) + (1.0 / (length * 0.5)));
+    upstreamVelocity = (upstreamElement->flow.value / upstreamElement->xSectionArea) * upstreamElementDirection * upstreamNeighbourWeight +
+                       (flow.value / xSectionArea) * upstreamCenterWeight;
 
-    upstreamXSectionArea = ((upstreamElement->xSectionArea / (upstreamElement->length * 0.5)) + (xSectionArea / (length * 0.5))) /
-                           ((1.0 / (upstreamElement->length * 0.5)) + (1.0 / (length * 0.5)));
+    upstreamXSectionArea = upstreamElement->xSectionArea * upstreamNeighbourWeight + xSectionArea * upstreamCenterWeight;
 
-
-    upstreamCourantNumber = upstreamVelocity * model->m_timeStep / (length / 2.0 + upstreamElement->length / 2.0);
+    upstreamCourantNumber = upstreamVelocity * model->m_timeStep / upstreamDistance;
 
   }
   else
@@ -783,18 +850,15 @@ void Element::computeDerivedHydraulics()
 
   if(downstreamElement != nullptr)
   {
-    downstreamFlow = ((downstreamElement->flow.value  * downstreamElementDirection  / (downstreamElement->length * 0.5)) +
-                      (flow.value  / (length * 0.5))) /
-                     ((1.0 / (downstreamElement->length * 0.5)) + (1.0 / (length * 0.5)));
+    downstreamFlow = downstreamElement->flow.value * downstreamElementDirection * downstreamNeighbourWeight +
+                     flow.value * downstreamCenterWeight;
 
-    downstreamVelocity = (((downstreamElement->flow.value  / downstreamElement->xSectionArea )* downstreamElementDirection  / (downstreamElement->length * 0.5)) +
-                          ((flow.value  / xSectionArea) / (length * 0.5))) /
-                         ((1.0 / (downstreamElement->length * 0.5)) + (1.0 / (length * 0.5)));
+    downstreamVelocity = (downstreamElement->flow.value / downstreamElement->xSectionArea) * downstreamElementDirection * downstreamNeighbourWeight +
+                         (flow.value / xSectionArea) * downstreamCenterWeight;
 
-    downstreamXSectionArea = ((downstreamElement->xSectionArea / (downstreamElement->length * 0.5)) + (xSectionArea / (length * 0.5))) /
-                             ((1.0 / (downstreamElement->length * 0.5)) + (1.0 / (length * 0.5)));
+    downstreamXSectionArea = downstreamElement->xSectionArea * downstreamNeighbourWeight + xSectionArea * downstreamCenterWeight;
 
-    downstreamCourantNumber = downstreamVelocity * model->m_timeStep / (length / 2.0 + downstreamElement->length / 2.0);
+    downstreamCourantNumber = downstreamVelocity * model->m_timeStep / downstreamDistance;
 
   }
   else
@@ -806,14 +870,34 @@ void Element::computeDerivedHydraulics()
   }
 
   //  setDispersionFunctions();
-  (*setAdvectionFuctions)(this);
+  int advectionRegime = computeAdvectionRegime();
+
+  if(advectionRegime != currentAdvectionRegime)
+  {
+    (*setAdvectionFuctions)(this);
+    currentAdvectionRegime = advectionRegime;
+    advectionDispatchCount++;
+  }
+}
+
+int Element::computeAdvectionRegime() const
+{
+  bool positiveFlow = flow.value >= 0;
+  int regime = positiveFlow ? 1 : 0;
+
+  if(model->m_advectionMode == CSHModel::Hybrid)
+  {
+    regime |= pecletRegime(upstreamPecletNumber, positiveFlow) << 1;
+    regime |= pecletRegime(downstreamPecletNumber, positiveFlow) << 3;
+  }
+
+  return regime;
 }
 
 void Element::computeLongDispersion()
 {
   double vel = flow.value  / xSectionArea;
 
-  slope = max(0.00001, fabs(upstreamJunction->z - downstreamJunction->z) / length);
   double fricVel = sqrt(9.81 * depth * slope);
   double dispFischer = model->m_computeDispersion  * (0.011 * vel * vel * width * width) / (depth * fricVel);
   double dispNumerical = model->m_computeDispersion * fabs(vel * length / 2.0);
@@ -832,14 +916,13 @@ void Element::computeUpstreamPeclet()
   if(upstreamElement != nullptr)
   {
 
-    upstreamLongDispersion =  ((upstreamElement->longDispersion.value / (upstreamElement->length * 0.5)) + (longDispersion.value / (length * 0.5))) /
-                              ((1.0 / (upstreamElement->length * 0.5)) + (1.0 / (length * 0.5)));
+    upstreamLongDispersion = upstreamElement->longDispersion.value * upstreamNeighbourWeight + longDispersion.value * upstreamCenterWeight;
 
-    double dispNum =   model->m_computeDispersion * fabs(upstreamVelocity) * (length / 2.0 + upstreamElement->length / 2.0) / 2.0;
+    double dispNum =   model->m_computeDispersion * fabs(upstreamVelocity) * upstreamDistance / 2.0;
 
     upstreamLongDispersion = dispNum < upstreamLongDispersion ? upstreamLongDispersion - dispNum : dispNum;
 
-    upstreamPecletNumber = upstreamLongDispersion > 0 ? upstreamVelocity * ((upstreamElement->length / 2.0) + (length / 2.0)) / (upstreamLongDispersion)
+    upstreamPecletNumber = upstreamLongDispersion > 0 ? upstreamVelocity * upstreamDistance / (upstreamLongDispersion)
                                                       : upstreamVelocity * 10000 / upstreamVelocity;
   }
   else
@@ -859,16 +942,14 @@ void Element::computeDownstreamPeclet()
 {
   if(downstreamElement != nullptr)
   {
-    downstreamLongDispersion = ((downstreamElement->longDispersion.value / (downstreamElement->length * 0.5)) + (longDispersion.value / (length * 0.5))) /
-                               ((1.0 / (downstreamElement->length * 0.5)) + (1.0 / (length * 0.5)));
+    downstreamLongDispersion = downstreamElement->longDispersion.value * downstreamNeighbourWeight + longDispersion.value * downstreamCenterWeight;
 
-
-    double dispNum = model->m_computeDispersion *  fabs(downstreamVelocity) * (length / 2.0 + downstreamElement->length / 2.0) / 2.0;
+    double dispNum = model->m_computeDispersion *  fabs(downstreamVelocity) * downstreamDistance / 2.0;
 
     downstreamLongDispersion = dispNum < downstreamLongDispersion ? downstreamLongDispersion - dispNum : dispNum;
 
 
-    downstreamPecletNumber = downstreamLongDispersion > 0 ? downstreamVelocity * ((downstreamElement->length / 2.0) + (length / 2.0)) / (downstreamLongDispersion)
+    downstreamPecletNumber = downstreamLongDispersion > 0 ? downstreamVelocity * downstreamDistance / (downstreamLongDispersion)
                                                           : downstreamVelocity * 10000 / downstreamVelocity;
   }
   else
@@ -883,7 +964,7 @@ void Element::computeDownstreamPeclet()
   }
 }
 
-void Element::computeHeatBalance(double timeStep)
+void Element::computeHeatBalance(double timeStep, double previousTemperature)
 {
   double radiationEnergy = radiationFluxes * top_area * timeStep / 1000.0;
   totalRadiationFluxesHeatBalance += radiationEnergy;
@@ -891,7 +972,7 @@ void Element::computeHeatBalance(double timeStep)
   double externalEnergy = externalHeatFluxes * xSectionArea * length * timeStep / 1000.0;
   totalExternalHeatFluxesBalance += externalEnergy;
 
-  double totalHeatEnergy = model->m_waterDensity * model->m_cp * xSectionArea * length * (temperature.value - prevTemperature.value) / 1000.0;
+  double totalHeatEnergy = model->m_waterDensity * model->m_cp * xSectionArea * length * (temperature.value - previousTemperature) / 1000.0;
   totalHeatBalance +=  totalHeatEnergy;
 
   double totalEvaporationHeat = evaporationHeatFlux * top_area * timeStep / 1000.0;
@@ -905,13 +986,13 @@ void Element::computeHeatBalance(double timeStep)
 
 }
 
-void Element::computeSoluteBalance(double timeStep, int soluteIndex)
+void Element::computeSoluteBalance(double timeStep, int soluteIndex, double previousSoluteConc)
 {
 
   double externalMass = externalSoluteFluxes[soluteIndex] * xSectionArea * length * timeStep;
   totalExternalSoluteFluxesMassBalance[soluteIndex] += externalMass;
 
-  double totalMass = model->m_waterDensity * xSectionArea * length * (soluteConcs[soluteIndex].value - prevSoluteConcs[soluteIndex].value) ;
+  double totalMass = model->m_waterDensity * xSectionArea * length * (soluteConcs[soluteIndex].value - previousSoluteConc) ;
   totalSoluteMassBalance[soluteIndex] +=  totalMass;
 
   double advDispMass = totalMass - externalMass;
@@ -926,7 +1007,7 @@ void Element::setUpstreamElement()
 
   if(upstreamJunction->junctionType == ElementJunction::DoubleElement)
   {
-    for(Element *element : upstreamJunction->incomingElements)
+    for(Element *element : upstreamJunction->incoming)
     {
       if(element != this)
       {
@@ -936,7 +1017,7 @@ void Element::setUpstreamElement()
       }
     }
 
-    for(Element *element : upstreamJunction->outgoingElements)
+    for(Element *element : upstreamJunction->outgoing)
     {
       if(element != this)
       {
@@ -955,7 +1036,7 @@ void Element::setDownStreamElement()
 
   if(downstreamJunction->junctionType == ElementJunction::DoubleElement)
   {
-    for(Element *element : downstreamJunction->outgoingElements)
+    for(Element *element : downstreamJunction->outgoing)
     {
       if(element != this)
       {
@@ -965,7 +1046,7 @@ void Element::setDownStreamElement()
       }
     }
 
-    for(Element *element : upstreamJunction->incomingElements)
+    for(Element *element : upstreamJunction->incoming)
     {
       if(element != this)
       {
@@ -981,13 +1062,11 @@ void Element::computeDownstreamFlow()
 {
   if(downstreamElement != nullptr)
   {
-    downstreamFlow = ((downstreamElement->flow.value  * downstreamElementDirection  / (downstreamElement->length * 0.5)) +
-                      (flow.value  / (length * 0.5))) /
-                     ((1.0 / (downstreamElement->length * 0.5)) + (1.0 / (length * 0.5)));
+    downstreamFlow = downstreamElement->flow.value * downstreamElementDirection * downstreamNeighbourWeight +
+                     flow.value * downstreamCenterWeight;
 
-    downstreamVelocity = (((downstreamElement->flow.value  / downstreamElement->xSectionArea ) * downstreamElementDirection / (downstreamElement->length * 0.5)) +
-                          ((flow.value  / xSectionArea) / (length * 0.5))) /
-                         ((1.0 / (downstreamElement->length * 0.5)) + (1.0 / (length * 0.5)));
+    downstreamVelocity = (downstreamElement->flow.value / downstreamElement->xSectionArea) * downstreamElementDirection * downstreamNeighbourWeight +
+                         (flow.value / xSectionArea) * downstreamCenterWeight;
   }
   else
   {
@@ -998,23 +1077,14 @@ void Element::computeDownstreamFlow()
 
 void Element::deleteSoluteVariables()
 {
-  if(soluteConcs)
-  {
-    delete[] soluteConcs; soluteConcs = nullptr;
-    delete[] prevSoluteConcs; prevSoluteConcs = nullptr;
-    delete[] externalSoluteFluxes; externalSoluteFluxes = nullptr;
-    delete[] totalSoluteMassBalance; totalSoluteMassBalance = nullptr;
-    delete[] totalAdvDispSoluteMassBalance; totalAdvDispSoluteMassBalance = nullptr;
-    delete[] totalExternalSoluteFluxesMassBalance; totalExternalSoluteFluxesMassBalance = nullptr;
-    delete[] sIndex; sIndex = nullptr;
-
-    for(int i = 0; i < numSolutes; i++)
-    {
-      delete[] computeSoluteAdvDeriv[i];
-      delete[] computeSoluteDispDeriv[i];
-    }
-
-    delete[] computeSoluteAdvDeriv; computeSoluteAdvDeriv = nullptr;
-    delete[] computeSoluteDispDeriv; computeSoluteDispDeriv = nullptr;
-  }
+  //The memory is released with the arena of the model
+  soluteConcs = nullptr;
+  prevSoluteConcs = nullptr;
+  externalSoluteFluxes = nullptr;
+  totalSoluteMassBalance = nullptr;
+  totalAdvDispSoluteMassBalance = nullptr;
+  totalExternalSoluteFluxesMassBalance = nullptr;
+  sIndex = nullptr;
+  computeSoluteAdvDeriv = nullptr;
+  computeSoluteDispDeriv = nullptr;
 }
@@ -92,9 +92,8 @@ void ElementAdvCentral::setAdvectionFunction(Element *element)
 
 double ElementAdvCentral::fluxUpNeighbour(Element *element, double dt, double T[])
 {
-  double denom = (1.0 / element->upstreamElement->length / 2.0) + (1.0 / element->length/ 2.0);
-  double centerFactor = 1.0 / element->length / 2.0 / denom;
-  double upstreamFactor = 1.0 / element->upstreamElement->length / 2.0 / denom;
+  double centerFactor = element->upstreamCenterWeight;
+  double upstreamFactor = element->upstreamNeighbourWeight;
 
   double incomingFlux = element->rho_cp  * (element->upstreamElement->flow.value * T[element->upstreamElement->tIndex] * upstreamFactor +
                         element->flow.value  * T[element->tIndex] * centerFactor);
@@ -104,9 +103,8 @@ double ElementAdvCentral::fluxUpNeighbour(Element *element, double dt, double T[
 
 double ElementAdvCentral::fluxDownNeighbour(Element *element, double dt, double T[])
 {
-  double denom = (1.0 / element->downstreamElement->length / 2.0) + (1.0 / element->length/ 2.0);
-  double centerFactor = 1.0 / element->length / 2.0 / denom;
-  double downstreamFactor = 1.0 / element->downstreamElement->length / 2.0 / denom;
+  double centerFactor = element->downstreamCenterWeight;
+  double downstreamFactor = element->downstreamNeighbourWeight;
 
   double outgoingFlux = -element->rho_cp * (element->downstreamElement->flow.value * T[element->downstreamElement->tIndex] * downstreamFactor +
                  element->flow.value * T[element->tIndex] * centerFactor);
@@ -116,11 +114,10 @@ double ElementAdvCentral::fluxDownNeighbour(Element *element, double dt, double
 
 double ElementAdvCentral::fluxUpNeighbour(Element *element, double dt, double S[], int soluteIndex)
 {
-  double denom = (1.0 / element->upstreamElement->length / 2.0) + (1.0 / element->length/ 2.0);
-  double centerFactor = 1.0 / element->length / 2.0 / denom;
-  double upstreamFactor = 1.0 / element->upstreamElement->length / 2.0 / denom;
+  double centerFactor = element->upstreamCenterWeight;
+  double upstreamFactor = element->upstreamNeighbourWeight;
 
-  double incomingFlux = element->upstreamElement->flow.value * S[element->upstreamElement->tIndex] * upstreamFactor +
+  double incomingFlux = element->upstreamElement->flow.value * S[element->upstreamElement->sIndex[soluteIndex]] * upstreamFactor +
                         element->flow.value  * S[element->sIndex[soluteIndex]] * centerFactor;
 
   return incomingFlux;
@@ -128,9 +125,8 @@ double ElementAdvCentral::fluxUpNeighbour(Element *element, double dt, double S[
 
 double ElementAdvCentral::fluxDownNeighbour(Element *element, double dt, double S[], int soluteIndex)
 {
-  double denom = (1.0 / element->downstreamElement->length / 2.0) + (1.0 / element->length/ 2.0);
-  double centerFactor = 1.0 / element->length / 2.0 / denom;
-  double downstreamFactor = 1.0 / element->downstreamElement->length / 2.0 / denom;
+  double centerFactor = element->downstreamCenterWeight;
+  double downstreamFactor = element->downstreamNeighbourWeight;
 
   double outgoingFlux = -(element->downstreamElement->flow.value * S[element->downstreamElement->sIndex[soluteIndex]] * downstreamFactor +
                  element->flow.value * S[element->sIndex[soluteIndex]] * centerFactor);
@@ -185,13 +185,8 @@ void ElementAdvHybrid::setAdvectionFunction(Element *element)
 
 double ElementAdvHybrid::fluxUpNeighbour(Element *element, double dt, double T[])
 {
-  double upstreamFactor = 1.0 / element->upstreamElement->length / 2.0;
-  double centerFactor = 1.0 / element->length / 2.0;
-
-  double idwDenomFactor = upstreamFactor + centerFactor;
-
-  upstreamFactor = upstreamFactor / idwDenomFactor;
-  centerFactor   = centerFactor / idwDenomFactor;
+  double upstreamFactor = element->upstreamNeighbourWeight;
+  double centerFactor = element->upstreamCenterWeight;
 
   upstreamFactor = (1 + (1.0 / element->upstreamPecletNumber / upstreamFactor)) * upstreamFactor;
   centerFactor   = (1 - (1.0 / element->upstreamPecletNumber / centerFactor)) * centerFactor;
@@ -204,13 +199,8 @@ double ElementAdvHybrid::fluxUpNeighbour(Element *element, double dt, double T[]
 
 double ElementAdvHybrid::fluxDownNeighbour(Element *element, double dt, double T[])
 {
-  double downstreamFactor = 1.0 / element->downstreamElement->length / 2.0;
-  double centerFactor = 1.0 / element->length / 2.0;
-
-  double idwDenomFactor = centerFactor + downstreamFactor;
-
-  centerFactor /= idwDenomFactor;
-  downstreamFactor   /= idwDenomFactor;
+  double downstreamFactor = element->downstreamNeighbourWeight;
+  double centerFactor = element->downstreamCenterWeight;
 
   centerFactor = (1 + (1.0 / element->downstreamPecletNumber/ centerFactor )) * centerFactor;
   downstreamFactor = (1 - (1.0 / element->downstreamPecletNumber / downstreamFactor)) * downstreamFactor;
@@ -223,13 +213,8 @@ double ElementAdvHybrid::fluxDownNeighbour(Element *element, double dt, double T
 
 double ElementAdvHybrid::fluxUpNeighbour(Element *element, double dt, double S[], int soluteIndex)
 {
-  double upstreamFactor = 1.0 / element->upstreamElement->length / 2.0;
-  double centerFactor = 1.0 / element->length / 2.0;
-
-  double idwDenomFactor = upstreamFactor + centerFactor;
-
-  upstreamFactor = upstreamFactor / idwDenomFactor;
-  centerFactor   = centerFactor / idwDenomFactor;
+  double upstreamFactor = element->upstreamNeighbourWeight;
+  double centerFactor = element->upstreamCenterWeight;
 
   upstreamFactor = (1 + (1.0 / element->upstreamPecletNumber / upstreamFactor)) * upstreamFactor;
   centerFactor   = (1 - (1.0 / element->upstreamPecletNumber / centerFactor)) * centerFactor;
@@ -242,13 +227,8 @@ double ElementAdvHybrid::fluxUpNeighbour(Element *element, double dt, double S[]
 
 double ElementAdvHybrid::fluxDownNeighbour(Element *element, double dt, double S[], int soluteIndex)
 {
-  double downstreamFactor = 1.0 / element->downstreamElement->length / 2.0;
-  double centerFactor = 1.0 / element->length / 2.0;
-
-  double idwDenomFactor = centerFactor + downstreamFactor;
-
-  centerFactor /= idwDenomFactor;
-  downstreamFactor   /= idwDenomFactor;
+  double downstreamFactor = element->downstreamNeighbourWeight;
+  double centerFactor = element->downstreamCenterWeight;
 
   centerFactor = (1 + (1.0 / element->downstreamPecletNumber/ centerFactor )) * centerFactor;
   downstreamFactor = (1 - (1.0 / element->downstreamPecletNumber / downstreamFactor)) * downstreamFactor;
@@ -209,8 +209,7 @@ double ElementAdvTVD::fluxUpNeighbour(Element *element, double dt, double T[])
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->upstreamElement->length / 2.0 / denom;
+  double interpFactor = element->upstreamCenterWeight;
 
   double incomingFlux = element->rho_cp * element->upstreamElement->flow.value * T[element->upstreamElement->tIndex] +
                         element->rho_cp * rw_func * interpFactor *
@@ -231,8 +230,7 @@ double ElementAdvTVD::fluxUpJunction(Element *element, double dt, double T[])
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->upstreamElement->length / 2.0 / denom;
+  double interpFactor = element->upstreamCenterWeight;
 
   double incomingFlux = element->rho_cp * element->upstreamElement->flow.value * T[element->upstreamElement->tIndex] +
                         element->rho_cp * rw_func * interpFactor *
@@ -253,8 +251,7 @@ double ElementAdvTVD::fluxUpJunctionBC(Element *element, double dt, double T[])
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->upstreamElement->length / 2.0 / denom;
+  double interpFactor = element->upstreamCenterWeight;
 
   double incomingFlux = element->rho_cp * element->upstreamElement->flow.value * T[element->upstreamElement->tIndex] +
                         element->rho_cp * rw_func * interpFactor *
@@ -273,8 +270,7 @@ double ElementAdvTVD::fluxDownNeighbourUpstreamNeighbour(Element *element, doubl
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->downstreamNeighbourWeight;
 
   double outgoingFlux = element->rho_cp * element->flow.value * T[element->tIndex] +
                         element->rho_cp * re_func * interpFactor *
@@ -293,8 +289,7 @@ double ElementAdvTVD::fluxDownNeighbourUpstreamJunction(Element *element, double
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->downstreamNeighbourWeight;
 
   double outgoingFlux = element->rho_cp * element->flow.value * T[element->tIndex] +
                         element->rho_cp * re_func * interpFactor *
@@ -313,8 +308,7 @@ double ElementAdvTVD::fluxDownNeighbourUpstreamJunctionBC(Element *element, doub
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->downstreamNeighbourWeight;
 
   double outgoingFlux = element->rho_cp * element->flow.value * T[element->tIndex] +
                         element->rho_cp * re_func * interpFactor *
@@ -336,8 +330,7 @@ double ElementAdvTVD::fluxDownNeighbour(Element *element, double dt, double T[])
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->downstreamElement->length / 2.0 / denom;
+  double interpFactor = element->downstreamCenterWeight;
 
   double incomingFlux = element->rho_cp * element->downstreamElement->flow.value * T[element->downstreamElement->tIndex] +
                         element->rho_cp * rw_func * interpFactor *
@@ -358,8 +351,7 @@ double ElementAdvTVD::fluxDownJunction(Element *element, double dt, double T[])
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->downstreamElement->length / 2.0 / denom;
+  double interpFactor = element->downstreamCenterWeight;
 
   double incomingFlux = element->rho_cp * element->downstreamElement->flow.value * T[element->downstreamElement->tIndex] +
                         element->rho_cp * rw_func * interpFactor *
@@ -380,8 +372,7 @@ double ElementAdvTVD::fluxDownJunctionBC(Element *element, double dt, double T[]
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->downstreamElement->length / 2.0 / denom;
+  double interpFactor = element->downstreamCenterWeight;
 
   double incomingFlux = element->rho_cp * element->downstreamElement->flow.value * T[element->downstreamElement->tIndex] +
                         element->rho_cp * rw_func * interpFactor *
@@ -401,8 +392,7 @@ double ElementAdvTVD::fluxUpNeighbourDownstreamNeighbour(Element *element, doubl
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->upstreamNeighbourWeight;
 
   double outgoingFlux = element->rho_cp * element->flow.value * T[element->tIndex] +
                         element->rho_cp * re_func * interpFactor *
@@ -422,8 +412,7 @@ double ElementAdvTVD::fluxUpNeighbourDownstreamJunction(Element *element, double
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->upstreamNeighbourWeight;
 
   double outgoingFlux = element->rho_cp * element->flow.value * T[element->tIndex] +
                         element->rho_cp * re_func * interpFactor *
@@ -443,8 +432,7 @@ double ElementAdvTVD::fluxUpNeighbourDownstreamJunctionBC(Element *element, doub
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->upstreamNeighbourWeight;
 
   double outgoingFlux = element->rho_cp * element->flow.value * T[element->tIndex] +
                         element->rho_cp * re_func * interpFactor *
@@ -465,8 +453,7 @@ double ElementAdvTVD::fluxUpNeighbour(Element *element, double dt, double S[], i
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->upstreamElement->length / 2.0 / denom;
+  double interpFactor = element->upstreamCenterWeight;
 
   double incomingFlux = element->upstreamElement->flow.value * S[element->upstreamElement->sIndex[soluteIndex]] +
                         rw_func * interpFactor *
@@ -487,8 +474,7 @@ double ElementAdvTVD::fluxUpJunction(Element *element, double dt, double S[], in
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->upstreamElement->length / 2.0 / denom;
+  double interpFactor = element->upstreamCenterWeight;
 
   double incomingFlux = element->upstreamElement->flow.value * S[element->upstreamElement->sIndex[soluteIndex]] +
                         rw_func * interpFactor *
@@ -509,8 +495,7 @@ double ElementAdvTVD::fluxUpJunctionBC(Element *element, double dt, double S[],
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->upstreamElement->length / 2.0 / denom;
+  double interpFactor = element->upstreamCenterWeight;
 
   double incomingFlux = element->upstreamElement->flow.value * S[element->upstreamElement->sIndex[soluteIndex]] +
                         rw_func * interpFactor *
@@ -529,8 +514,7 @@ double ElementAdvTVD::fluxDownNeighbourUpstreamNeighbour(Element *element, doubl
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->downstreamNeighbourWeight;
 
   double outgoingFlux = element->flow.value * S[element->sIndex[soluteIndex]] +
                         re_func * interpFactor *
@@ -549,8 +533,7 @@ double ElementAdvTVD::fluxDownNeighbourUpstreamJunction(Element *element, double
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->downstreamNeighbourWeight;
 
   double outgoingFlux = element->flow.value * S[element->sIndex[soluteIndex]] +
                         re_func * interpFactor *
@@ -569,8 +552,7 @@ double ElementAdvTVD::fluxDownNeighbourUpstreamJunctionBC(Element *element, doub
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->downstreamNeighbourWeight;
 
   double outgoingFlux = element->flow.value * S[element->sIndex[soluteIndex]] +
                         re_func * interpFactor *
@@ -592,8 +574,7 @@ double ElementAdvTVD::fluxDownNeighbour(Element *element, double dt, double S[],
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->downstreamElement->length / 2.0 / denom;
+  double interpFactor = element->downstreamCenterWeight;
 
   double incomingFlux = element->downstreamElement->flow.value * S[element->downstreamElement->sIndex[soluteIndex]]+
                         rw_func * interpFactor *
@@ -614,8 +595,7 @@ double ElementAdvTVD::fluxDownJunction(Element *element, double dt, double S[],
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->downstreamElement->length / 2.0 / denom;
+  double interpFactor = element->downstreamCenterWeight;
 
   double incomingFlux = element->downstreamElement->flow.value * S[element->downstreamElement->sIndex[soluteIndex]]+
                         rw_func * interpFactor *
@@ -636,8 +616,7 @@ double ElementAdvTVD::fluxDownJunctionBC(Element *element, double dt, double S[]
 
   double rw_func = computeTVDLimiter(rw, element->model->m_TVDFluxLimiter, element, 1);
 
-  double denom = (element->downstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->downstreamElement->length / 2.0 / denom;
+  double interpFactor = element->downstreamCenterWeight;
 
   double incomingFlux = element->downstreamElement->flow.value * S[element->downstreamElement->sIndex[soluteIndex]]+
                         rw_func * interpFactor *
@@ -657,8 +636,7 @@ double ElementAdvTVD::fluxUpNeighbourDownstreamNeighbour(Element *element, doubl
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->upstreamNeighbourWeight;
 
   double outgoingFlux = element->flow.value * S[element->sIndex[soluteIndex]] +
                         re_func * interpFactor *
@@ -678,8 +656,7 @@ double ElementAdvTVD::fluxUpNeighbourDownstreamJunction(Element *element, double
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->upstreamNeighbourWeight;
 
   double outgoingFlux = element->flow.value * S[element->sIndex[soluteIndex]] +
                         re_func * interpFactor *
@@ -699,8 +676,7 @@ double ElementAdvTVD::fluxUpNeighbourDownstreamJunctionBC(Element *element, doub
 
   double re_func = computeTVDLimiter(re, element->model->m_TVDFluxLimiter, element);
 
-  double denom = (element->upstreamElement->length / 2.0) + (element->length / 2.0);
-  double interpFactor = element->length / 2.0 / denom;
+  double interpFactor = element->upstreamNeighbourWeight;
 
   double outgoingFlux = element->flow.value * S[element->sIndex[soluteIndex]] +
                         re_func * interpFactor *
@@ -3,6 +3,7 @@
 #include "element.h"
 #include "cshmodel.h"
 #include "elementjunction.h"
+#include "elementstatestore.h"
 
 void ElementAdvUpwind::setAdvectionFunction(Element *element)
 {
@@ -80,82 +81,108 @@ void ElementAdvUpwind::setAdvectionFunction(Element *element)
 
 double ElementAdvUpwind::inFluxUpJunction(Element *element, double dt, double T[])
 {
-  return element->rho_cp * element->flow.value *  T[element->upstreamJunction->tIndex];
+  const ElementStateStore &state = element->model->m_elementState;
+  int i = element->index;
+  return state.rho_cp[i] * state.flow[i] *  T[element->upstreamJunction->tIndex];
 }
 
 double ElementAdvUpwind::inFluxUpJunctionBC(Element *element, double dt, double T[])
 {
-  return element->rho_cp * element->flow.value *  element->upstreamJunction->temperature.value;
+  const ElementStateStore &state = element->model->m_elementState;
+  int i = element->index;
+  return state.rho_cp[i] * state.flow[i] *  element->upstreamJunction->temperature.value;
 }
 
 double ElementAdvUpwind::inFluxUpNeighbour(Element *element, double dt, double T[])
 {
-  return element->rho_cp * element->upstreamElement->flow.value * T[element->upstreamElement->tIndex];
+  const ElementStateStore &state = element->model->m_elementState;
+  int i = element->index;
+  int up = state.upstreamElement[i];
+  return state.rho_cp[i] * state.flow[up] * T[state.tIndex[up]];
 }
 
 double ElementAdvUpwind::inFluxSelf(Element *element, double dt, double T[])
 {
-  return element->rho_cp * element->flow.value * T[element->tIndex];
+  const ElementStateStore &state = element->model->m_elementState;
+  int i = element->index;
+  return state.rho_cp[i] * state.flow[i] * T[state.tIndex[i]];
 }
 
 double ElementAdvUpwind::outFluxSelf(Element *element, double dt, double T[])
 {
-  return -element->rho_cp * element->flow.value * T[element->tIndex];
+  const ElementStateStore &state = element->model->m_elementState;
+  int i = element->index;
+  return -state.rho_cp[i] * state.flow[i] * T[state.tIndex[i]];
 }
 
 double ElementAdvUpwind::outFluxDownJunction(Element *element, double dt, double T[])
 {
-  return -element->rho_cp * element->flow.value * T[element->downstreamJunction->tIndex];
+  const ElementStateStore &state = element->model->m_elementState;
+  int i = element->index;
+  return -state.rho_cp[i] * state.flow[i] * T[element->downstreamJunction->tIndex];
 }
 
 double ElementAdvUpwind::outFluxDownJunctionBC(Element *element, double dt, double T[])
 {
-  return -element->rho_cp * element->flow.value * element->downstreamJunction->temperature.value;
+  const ElementStateStore &state = element->model->m_elementState;
+  int i = element->index;
+  return -state.rho_cp[i] * state.flow[i] * element->downstreamJunction->temperature.value;
 }
 
 double ElementAdvUpwind::outFluxDownNeighbor(Element *element, double dt, double T[])
 {
-  return -element->rho_cp * element->downstreamElement->flow.value * T[element->downstreamElement->tIndex];
+  const ElementStateStore &state = element->model->m_elementState;
+  int i = element->index;
+  int down = state.downstreamElement[i];
+  return -state.rho_cp[i] * state.flow[down] * T[state.tIndex[down]];
 }
 
 double ElementAdvUpwind::inFluxUpJunction(Element *element, double dt, double S[], int soluteIndex)
 {
-  return element->flow.value * S[element->upstreamJunction->sIndex[soluteIndex]];
+  return element->model->m_elementState.flow[element->index] * S[element->upstreamJunction->sIndex[soluteIndex]];
 }
 
 double ElementAdvUpwind::inFluxUpJunctionBC(Element *element, double dt, double S[], int soluteIndex)
 {
-  return element->flow.value * element->upstreamJunction->soluteConcs[soluteIndex].value;
+  return element->model->m_elementState.flow[element->index] * element->upstreamJunction->soluteConcs[soluteIndex].value;
 }
 
 double ElementAdvUpwind::inFluxUpNeighbour(Element *element, double dt, double S[], int soluteIndex)
 {
-  return element->upstreamElement->flow.value * S[element->upstreamElement->sIndex[soluteIndex]];
+  const ElementStateStore &state = element->model->m_elementState;
+  int up = state.upstreamElement[element->index];
+  return state.flow[up] * S[state.sIndex[soluteIndex][up]];
 }
 
 double ElementAdvUpwind::inFluxSelf(Element *element, double dt, double S[], int soluteIndex)
 {
-  return element->flow.value * S[element->sIndex[soluteIndex]];
+  const ElementStateStore &state = element->model->m_elementState;
+  int i = element->index;
+  return state.flow[i] * S[state.sIndex[soluteIndex][i]];
 }
 
 double ElementAdvUpwind::outFluxSelf(Element *element, double dt, double S[], int soluteIndex)
 {
-  return -element->flow.value * S[element->sIndex[soluteIndex]];
+  const ElementStateStore &state = element->model->m_elementState;
+  int i = element->index;
+  return -state.flow[i] * S[state.sIndex[soluteIndex][i]];
 }
 
 double ElementAdvUpwind::outFluxDownJunction(Element *element, double dt, double S[], int soluteIndex)
 {
-  return -element->flow.value * S[element->downstreamJunction->sIndex[soluteIndex]];
+  return -element->model->m_elementState.flow[element->index] * S[element->downstreamJunction->sIndex[soluteIndex]];
 }
 
 double ElementAdvUpwind::outFluxDownJunctionBC(Element *element, double dt, double S[], int soluteIndex)
 {
-  return -element->flow.value * element->downstreamJunction->soluteConcs[soluteIndex].value;
+  return -element->model->m_elementState.flow[element->index] * element->downstreamJunction->soluteConcs[soluteIndex].value;
 }
 
 double ElementAdvUpwind::outFluxDownNeighbor(Element *element, double dt, double S[], int soluteIndex)
 {
-  return -element->downstreamElement->flow.value * S[element->downstreamElement->sIndex[soluteIndex]];
+  const ElementStateStore &state = element->model->m_elementState;
+  int down = state.downstreamElement[element->index];
+  return -state.flow[down] * S[state.sIndex[soluteIndex][down]];
 }
 
 
@@ -0,0 +1,708 @@
+/*!
+*  \file    elementfluxkernels.cpp
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#include "stdafx.h"
+#include "elementfluxkernels.h"
+#include "elementstatestore.h"
+#include "element.h"
+#include "elementadvupwind.h"
+#include "elementadvcentral.h"
+#include "elementadvhybrid.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+
+/*!
+ * \brief The FaceVariable struct - Solver indexes and junction values of the variable a kernel operates on.
+ */
+struct FaceVariable
+{
+    const int *index;
+    const int *upstreamJunctionIndex;
+    const int *downstreamJunctionIndex;
+    const double *upstreamJunctionValue;
+    const double *downstreamJunctionValue;
+};
+
+/*!
+ * Advection face flux of element i. heat multiplies by rho_cp. The arithmetic mirrors the
+ * ElementAdvUpwind, ElementAdvCentral and ElementAdvHybrid functions term for term.
+ */
+template<int flux, bool heat>
+inline double advectionFlux(const ElementStateStore &state, const FaceVariable &var, int i, const double y[])
+{
+  const double c = heat ? state.rho_cp[i] : 1.0;
+
+  switch(flux)
+  {
+    case ElementFluxKernels::UpwindInFluxUpJunction:
+      return c * state.flow[i] * y[var.upstreamJunctionIndex[i]];
+    case ElementFluxKernels::UpwindInFluxUpJunctionBC:
+      return c * state.flow[i] * var.upstreamJunctionValue[i];
+    case ElementFluxKernels::UpwindInFluxUpNeighbour:
+      {
+        int up = state.upstreamElement[i];
+        return c * state.flow[up] * y[var.index[up]];
+      }
+    case ElementFluxKernels::UpwindInFluxSelf:
+      return c * state.flow[i] * y[var.index[i]];
+    case ElementFluxKernels::UpwindOutFluxSelf:
+      return -c * state.flow[i] * y[var.index[i]];
+    case ElementFluxKernels::UpwindOutFluxDownJunction:
+      return -c * state.flow[i] * y[var.downstreamJunctionIndex[i]];
+    case ElementFluxKernels::UpwindOutFluxDownJunctionBC:
+      return -c * state.flow[i] * var.downstreamJunctionValue[i];
+    case ElementFluxKernels::UpwindOutFluxDownNeighbour:
+      {
+        int down = state.downstreamElement[i];
+        return -c * state.flow[down] * y[var.index[down]];
+      }
+    case ElementFluxKernels::CentralFluxUpNeighbour:
+      {
+        int up = state.upstreamElement[i];
+        double centerFactor = state.upstreamCenterWeight[i];
+        double upstreamFactor = state.upstreamNeighbourWeight[i];
+
+        return c * (state.flow[up] * y[var.index[up]] * upstreamFactor +
+                    state.flow[i] * y[var.index[i]] * centerFactor);
+      }
+    case ElementFluxKernels::CentralFluxDownNeighbour:
+      {
+        int down = state.downstreamElement[i];
+        double centerFactor = state.downstreamCenterWeight[i];
+        double downstreamFactor = state.downstreamNeighbourWeight[i];
+
+        return -c * (state.flow[down] * y[var.index[down]] * downstreamFactor +
+                     state.flow[i] * y[var.index[i]] * centerFactor);
+      }
+    case ElementFluxKernels::HybridFluxUpNeighbour:
+      {
+        int up = state.upstreamElement[i];
+        double upstreamFactor = state.upstreamNeighbourWeight[i];
+        double centerFactor = state.upstreamCenterWeight[i];
+
+        upstreamFactor = (1 + (1.0 / state.upstreamPecletNumber[i] / upstreamFactor)) * upstreamFactor;
+        centerFactor = (1 - (1.0 / state.upstreamPecletNumber[i] / centerFactor)) * centerFactor;
+
+        return c * (state.flow[up] * y[var.index[up]] * upstreamFactor +
+                    state.flow[i] * y[var.index[i]] * centerFactor);
+      }
+    case ElementFluxKernels::HybridFluxDownNeighbour:
+      {
+        int down = state.downstreamElement[i];
+        double downstreamFactor = state.downstreamNeighbourWeight[i];
+        double centerFactor = state.downstreamCenterWeight[i];
+
+        centerFactor = (1 + (1.0 / state.downstreamPecletNumber[i] / centerFactor)) * centerFactor;
+        downstreamFactor = (1 - (1.0 / state.downstreamPecletNumber[i] / downstreamFactor)) * downstreamFactor;
+
+        return -(c * (state.flow[i] * y[var.index[i]] * centerFactor +
+                      state.flow[down] * y[var.index[down]] * downstreamFactor));
+      }
+  }
+
+  return 0.0;
+}
+
+/*!
+ * Dispersion face flux of element i. heat multiplies by rho_cp.
+ */
+template<int flux, bool heat>
+inline double dispersionFlux(const ElementStateStore &state, const FaceVariable &var, int i, const double y[])
+{
+  const double c = heat ? state.rho_cp[i] : 1.0;
+
+  switch(flux)
+  {
+    case ElementFluxKernels::DispersionUpJunction:
+      return state.upstreamLongDispersion[i] * state.upstreamXSectionArea[i] * c *
+          (y[var.upstreamJunctionIndex[i]] - y[var.index[i]]) * state.inverseHalfLength[i];
+    case ElementFluxKernels::DispersionUpJunctionBC:
+      return state.upstreamLongDispersion[i] * state.upstreamXSectionArea[i] * c *
+          (var.upstreamJunctionValue[i] - y[var.index[i]]) * state.inverseHalfLength[i];
+    case ElementFluxKernels::DispersionUpNeighbour:
+      {
+        int up = state.upstreamElement[i];
+        return state.upstreamLongDispersion[i] * state.upstreamXSectionArea[i] * c *
+            (y[var.index[up]] - y[var.index[i]]) * state.upstreamInverseDistance[i];
+      }
+    case ElementFluxKernels::DispersionDownJunction:
+      return state.downstreamLongDispersion[i] * state.downstreamXSectionArea[i] * c *
+          (y[var.downstreamJunctionIndex[i]] - y[var.index[i]]) * state.inverseHalfLength[i];
+    case ElementFluxKernels::DispersionDownJunctionBC:
+      return state.downstreamLongDispersion[i] * state.downstreamXSectionArea[i] * c *
+          (var.downstreamJunctionValue[i] - y[var.index[i]]) * state.inverseHalfLength[i];
+    case ElementFluxKernels::DispersionDownNeighbour:
+      {
+        int down = state.downstreamElement[i];
+        return state.downstreamLongDispersion[i] * state.downstreamXSectionArea[i] * c *
+            (y[var.index[down]] - y[var.index[i]]) * state.downstreamInverseDistance[i];
+      }
+  }
+
+  return 0.0;
+}
+
+/*!
+ * Evaluates one face group. Called inside a parallel region so the work sharing
+ * directive splits the group across the threads of the enclosing team. When scatter
+ * is set, the group holds interior faces owned by the downstream element and the flux is
+ * also written, negated, as the downstream face flux of the upstream element.
+ */
+template<int flux, bool heat, bool advection, bool scatter>
+void computeFaceGroup(const ElementStateStore &state, const FaceVariable &var, const vector<int> &faces,
+                      const double y[], double fluxes[], double downstreamFluxes[])
+{
+  const int *elements = faces.data();
+  int numFaces = faces.size();
+
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+  for(int k = 0; k < numFaces; k++)
+  {
+    int i = elements[k];
+    double faceFlux = advection ? advectionFlux<flux, heat>(state, var, i, y) :
+                                  dispersionFlux<flux, heat>(state, var, i, y);
+    fluxes[i] = faceFlux;
+
+    if(scatter)
+    {
+      downstreamFluxes[state.upstreamElement[i]] = -faceFlux;
+    }
+  }
+}
+
+template<bool heat, bool scatter>
+void computeAdvectionGroup(int flux, const ElementStateStore &state, const FaceVariable &var,
+                           const vector<int> &faces, const double y[], double fluxes[], double downstreamFluxes[])
+{
+  switch(flux)
+  {
+    case ElementFluxKernels::UpwindInFluxUpJunction:
+      computeFaceGroup<ElementFluxKernels::UpwindInFluxUpJunction, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::UpwindInFluxUpJunctionBC:
+      computeFaceGroup<ElementFluxKernels::UpwindInFluxUpJunctionBC, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::UpwindInFluxUpNeighbour:
+      computeFaceGroup<ElementFluxKernels::UpwindInFluxUpNeighbour, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::UpwindInFluxSelf:
+      computeFaceGroup<ElementFluxKernels::UpwindInFluxSelf, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::UpwindOutFluxSelf:
+      computeFaceGroup<ElementFluxKernels::UpwindOutFluxSelf, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::UpwindOutFluxDownJunction:
+      computeFaceGroup<ElementFluxKernels::UpwindOutFluxDownJunction, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::UpwindOutFluxDownJunctionBC:
+      computeFaceGroup<ElementFluxKernels::UpwindOutFluxDownJunctionBC, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::UpwindOutFluxDownNeighbour:
+      computeFaceGroup<ElementFluxKernels::UpwindOutFluxDownNeighbour, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::CentralFluxUpNeighbour:
+      computeFaceGroup<ElementFluxKernels::CentralFluxUpNeighbour, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::CentralFluxDownNeighbour:
+      computeFaceGroup<ElementFluxKernels::CentralFluxDownNeighbour, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::HybridFluxUpNeighbour:
+      computeFaceGroup<ElementFluxKernels::HybridFluxUpNeighbour, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::HybridFluxDownNeighbour:
+      computeFaceGroup<ElementFluxKernels::HybridFluxDownNeighbour, heat, true, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+  }
+}
+
+template<bool heat, bool scatter>
+void computeDispersionGroup(int flux, const ElementStateStore &state, const FaceVariable &var,
+                            const vector<int> &faces, const double y[], double fluxes[], double downstreamFluxes[])
+{
+  switch(flux)
+  {
+    case ElementFluxKernels::DispersionUpJunction:
+      computeFaceGroup<ElementFluxKernels::DispersionUpJunction, heat, false, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::DispersionUpJunctionBC:
+      computeFaceGroup<ElementFluxKernels::DispersionUpJunctionBC, heat, false, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::DispersionUpNeighbour:
+      computeFaceGroup<ElementFluxKernels::DispersionUpNeighbour, heat, false, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::DispersionDownJunction:
+      computeFaceGroup<ElementFluxKernels::DispersionDownJunction, heat, false, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::DispersionDownJunctionBC:
+      computeFaceGroup<ElementFluxKernels::DispersionDownJunctionBC, heat, false, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    case ElementFluxKernels::DispersionDownNeighbour:
+      computeFaceGroup<ElementFluxKernels::DispersionDownNeighbour, heat, false, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+    default:
+      computeFaceGroup<ElementFluxKernels::DispersionSelf, heat, false, scatter>(state, var, faces, y, fluxes, downstreamFluxes);
+      break;
+  }
+}
+
+}
+
+ElementFluxKernels::ElementFluxKernels()
+  : m_state(nullptr),
+    m_elements(nullptr),
+    m_numVariables(0),
+    m_faceAssembly(false)
+{
+}
+
+void ElementFluxKernels::initialize(const ElementStateStore *state, bool faceAssembly)
+{
+  m_state = state;
+  m_numVariables = 1 + state->numSolutes;
+  m_faceAssembly = faceAssembly;
+
+  m_advectionFaces.assign(m_numVariables * 2 * NumAdvectionFluxes, vector<int>());
+  m_dispersionFaces.assign(m_numVariables * 2 * NumDispersionFluxes, vector<int>());
+  m_interiorAdvectionFaces.assign(m_numVariables * NumAdvectionFluxes, vector<int>());
+  m_interiorDispersionFaces.assign(m_numVariables * NumDispersionFluxes, vector<int>());
+  m_advectionFluxes.assign(m_numVariables * 2, vector<double>(state->numElements, 0.0));
+  m_dispersionFluxes.assign(m_numVariables * 2, vector<double>(state->numElements, 0.0));
+}
+
+void ElementFluxKernels::classify(const std::vector<Element*> &elements)
+{
+  const ElementStateStore &state = *m_state;
+  m_elements = &elements;
+
+  for(size_t i = 0; i < m_advectionFaces.size(); i++)
+    m_advectionFaces[i].clear();
+
+  for(size_t i = 0; i < m_dispersionFaces.size(); i++)
+    m_dispersionFaces[i].clear();
+
+  for(size_t i = 0; i < m_interiorAdvectionFaces.size(); i++)
+    m_interiorAdvectionFaces[i].clear();
+
+  for(size_t i = 0; i < m_interiorDispersionFaces.size(); i++)
+    m_interiorDispersionFaces[i].clear();
+
+  for(int variable = 0; variable < m_numVariables; variable++)
+  {
+    for(int i = 0; i < state.numElements; i++)
+    {
+      const Element *element = elements[i];
+
+      //Upstream face. Interior faces between two neighbouring elements are owned by the downstream element.
+      if(isInteriorFace(i, variable))
+      {
+        m_interiorAdvectionFaces[variable * NumAdvectionFluxes + advectionFluxType(element, variable, 0)].push_back(i);
+        m_interiorDispersionFaces[variable * NumDispersionFluxes + DispersionUpNeighbour].push_back(i);
+      }
+      else
+      {
+        m_advectionFaces[groupIndex(variable, 0, advectionFluxType(element, variable, 0), NumAdvectionFluxes)].push_back(i);
+        m_dispersionFaces[groupIndex(variable, 0, dispersionFluxType(element, variable, 0), NumDispersionFluxes)].push_back(i);
+      }
+
+      //Downstream face. Skipped when the downstream neighbour owns the face.
+      int down = state.downstreamElement[i];
+
+      if(down < 0 || state.upstreamElement[down] != i || !isInteriorFace(down, variable))
+      {
+        m_advectionFaces[groupIndex(variable, 1, advectionFluxType(element, variable, 1), NumAdvectionFluxes)].push_back(i);
+        m_dispersionFaces[groupIndex(variable, 1, dispersionFluxType(element, variable, 1), NumDispersionFluxes)].push_back(i);
+      }
+    }
+  }
+}
+
+bool ElementFluxKernels::faceAssembly() const
+{
+  return m_faceAssembly;
+}
+
+void ElementFluxKernels::computeDTDt(const double T[], double DTDt[])
+{
+  computeFluxes(0, true, T);
+
+#ifdef USE_OPENMP
+#pragma omp barrier
+#endif
+
+  computeTemperatureRates(T, DTDt);
+}
+
+void ElementFluxKernels::computeDSoluteDt(int soluteIndex, double firstOrderK, const double S[], double DSoluteDt[])
+{
+  computeFluxes(soluteIndex + 1, false, S);
+
+#ifdef USE_OPENMP
+#pragma omp barrier
+#endif
+
+  computeSoluteRates(soluteIndex, firstOrderK, S, DSoluteDt);
+}
+
+void ElementFluxKernels::computeDerivatives(const std::vector<double> &firstOrderK, const double y[], double dydt[])
+{
+  //Each variable has its own face flux arrays so the fluxes of all the variables are evaluated before synchronizing
+  for(int variable = 0; variable < m_numVariables; variable++)
+  {
+    computeFluxes(variable, variable == 0, y);
+  }
+
+#ifdef USE_OPENMP
+#pragma omp barrier
+#endif
+
+  computeTemperatureRates(y, dydt);
+
+  for(int j = 0; j < m_numVariables - 1; j++)
+  {
+    computeSoluteRates(j, firstOrderK[j], y, dydt);
+  }
+}
+
+void ElementFluxKernels::computeTemperatureRates(const double T[], double DTDt[])
+{
+  const ElementStateStore &state = *m_state;
+
+  const double *adv0 = m_advectionFluxes[0].data();
+  const double *adv1 = m_advectionFluxes[1].data();
+  const double *disp0 = m_dispersionFluxes[0].data();
+  const double *disp1 = m_dispersionFluxes[1].data();
+
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+  for(int i = 0; i < state.numElements; i++)
+  {
+    double dTdt = 0.0;
+
+    if(state.volume[i] > 1e-12)
+    {
+      //Compute advection
+      dTdt += (adv0[i] + adv1[i]) / state.rho_cp_vol[i];
+
+      //Compute dispersion
+      dTdt += (disp0[i] + disp1[i]) / state.rho_cp_vol[i];
+
+      //External sources, evaporation, convection, fluid friction
+      dTdt += state.heatSources[i];
+
+      //Product rule subtract volume derivative
+      dTdt -= T[state.tIndex[i]] * state.dvolume_dt[i] / state.volume[i];
+    }
+
+    DTDt[state.tIndex[i]] = dTdt;
+  }
+}
+
+void ElementFluxKernels::computeSoluteRates(int soluteIndex, double firstOrderK, const double S[], double DSoluteDt[])
+{
+  const ElementStateStore &state = *m_state;
+  int variable = soluteIndex + 1;
+
+  const double *adv0 = m_advectionFluxes[variable * 2].data();
+  const double *adv1 = m_advectionFluxes[variable * 2 + 1].data();
+  const double *disp0 = m_dispersionFluxes[variable * 2].data();
+  const double *disp1 = m_dispersionFluxes[variable * 2 + 1].data();
+  const int *sIndex = state.sIndex[soluteIndex].data();
+  const double *soluteConcs = state.soluteConcs[soluteIndex].data();
+  const double *externalSoluteFluxes = state.externalSoluteFluxes[soluteIndex].data();
+
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+  for(int i = 0; i < state.numElements; i++)
+  {
+    double dSdt = 0.0;
+
+    if(state.volume[i] > 1e-18)
+    {
+      //Compute advection
+      dSdt += (adv0[i] + adv1[i]) / state.sol_volume[i];
+
+      //Compute dispersion
+      dSdt += (disp0[i] + disp1[i]) / state.volume[i];
+
+      //First order reaction reaction
+      dSdt += firstOrderK * soluteConcs[i];
+
+      //subtract chain rule volume derivative
+      dSdt -= (S[sIndex[i]] * state.dvolume_dt[i]) / state.sol_volume[i];
+
+      //Add external sources
+      dSdt += externalSoluteFluxes[i] / state.sol_volume[i];
+    }
+
+    DSoluteDt[sIndex[i]] = dSdt;
+  }
+}
+
+int ElementFluxKernels::groupIndex(int variable, int slot, int flux, int numFluxes)
+{
+  return (variable * 2 + slot) * numFluxes + flux;
+}
+
+int ElementFluxKernels::advectionFluxType(const Element *element, int variable, int slot)
+{
+  struct TempAdvectionFunction { ComputeTempAdvDeriv function; int flux; };
+  struct SoluteAdvectionFunction { ComputeSoluteAdvDeriv function; int flux; };
+
+  static const TempAdvectionFunction tempAdvectionFunctions[] =
+  {
+    {&ElementAdvUpwind::inFluxUpJunction, UpwindInFluxUpJunction},
+    {&ElementAdvUpwind::inFluxUpJunctionBC, UpwindInFluxUpJunctionBC},
+    {&ElementAdvUpwind::inFluxUpNeighbour, UpwindInFluxUpNeighbour},
+    {&ElementAdvUpwind::inFluxSelf, UpwindInFluxSelf},
+    {&ElementAdvUpwind::outFluxSelf, UpwindOutFluxSelf},
+    {&ElementAdvUpwind::outFluxDownJunction, UpwindOutFluxDownJunction},
+    {&ElementAdvUpwind::outFluxDownJunctionBC, UpwindOutFluxDownJunctionBC},
+    {&ElementAdvUpwind::outFluxDownNeighbor, UpwindOutFluxDownNeighbour},
+    {&ElementAdvCentral::fluxUpNeighbour, CentralFluxUpNeighbour},
+    {&ElementAdvCentral::fluxDownNeighbour, CentralFluxDownNeighbour},
+    {&ElementAdvHybrid::fluxUpNeighbour, HybridFluxUpNeighbour},
+    {&ElementAdvHybrid::fluxDownNeighbour, HybridFluxDownNeighbour}
+  };
+
+  static const SoluteAdvectionFunction soluteAdvectionFunctions[] =
+  {
+    {&ElementAdvUpwind::inFluxUpJunction, UpwindInFluxUpJunction},
+    {&ElementAdvUpwind::inFluxUpJunctionBC, UpwindInFluxUpJunctionBC},
+    {&ElementAdvUpwind::inFluxUpNeighbour, UpwindInFluxUpNeighbour},
+    {&ElementAdvUpwind::inFluxSelf, UpwindInFluxSelf},
+    {&ElementAdvUpwind::outFluxSelf, UpwindOutFluxSelf},
+    {&ElementAdvUpwind::outFluxDownJunction, UpwindOutFluxDownJunction},
+    {&ElementAdvUpwind::outFluxDownJunctionBC, UpwindOutFluxDownJunctionBC},
+    {&ElementAdvUpwind::outFluxDownNeighbor, UpwindOutFluxDownNeighbour},
+    {&ElementAdvCentral::fluxUpNeighbour, CentralFluxUpNeighbour},
+    {&ElementAdvCentral::fluxDownNeighbour, CentralFluxDownNeighbour},
+    {&ElementAdvHybrid::fluxUpNeighbour, HybridFluxUpNeighbour},
+    {&ElementAdvHybrid::fluxDownNeighbour, HybridFluxDownNeighbour}
+  };
+
+  if(variable == 0)
+  {
+    for(const TempAdvectionFunction &f : tempAdvectionFunctions)
+    {
+      if(element->computeTempAdvDeriv[slot] == f.function)
+        return f.flux;
+    }
+  }
+  else
+  {
+    for(const SoluteAdvectionFunction &f : soluteAdvectionFunctions)
+    {
+      if(element->computeSoluteAdvDeriv[variable - 1][slot] == f.function)
+        return f.flux;
+    }
+  }
+
+  return ElementFunction;
+}
+
+int ElementFluxKernels::dispersionFluxType(const Element *element, int variable, int slot)
+{
+  struct TempDispersionFunction { ComputeTempDeriv function; int flux; };
+  struct SoluteDispersionFunction { ComputeSoluteDeriv function; int flux; };
+
+  static const TempDispersionFunction tempDispersionFunctions[] =
+  {
+    {&Element::computeDTDtDispersionUpstreamJunction, DispersionUpJunction},
+    {&Element::computeDTDtDispersionUpstreamJunctionBC, DispersionUpJunctionBC},
+    {&Element::computeDTDtDispersionUpstreamNeighbour, DispersionUpNeighbour},
+    {&Element::computeDTDtDispersionDownstreamJunction, DispersionDownJunction},
+    {&Element::computeDTDtDispersionDownstreamJunctionBC, DispersionDownJunctionBC},
+    {&Element::computeDTDtDispersionDownstreamNeighbour, DispersionDownNeighbour}
+  };
+
+  static const SoluteDispersionFunction soluteDispersionFunctions[] =
+  {
+    {&Element::computeDSoluteDtDispersionUpstreamJunction, DispersionUpJunction},
+    {&Element::computeDSoluteDtDispersionUpstreamJunctionBC, DispersionUpJunctionBC},
+    {&Element::computeDSoluteDtDispersionUpstreamNeighbour, DispersionUpNeighbour},
+    {&Element::computeDSoluteDtDispersionDownstreamJunction, DispersionDownJunction},
+    {&Element::computeDSoluteDtDispersionDownstreamJunctionBC, DispersionDownJunctionBC},
+    {&Element::computeDSoluteDtDispersionDownstreamNeighbour, DispersionDownNeighbour}
+  };
+
+  if(variable == 0)
+  {
+    for(const TempDispersionFunction &f : tempDispersionFunctions)
+    {
+      if(element->computeTempDispDeriv[slot] == f.function)
+        return f.flux;
+    }
+  }
+  else
+  {
+    for(const SoluteDispersionFunction &f : soluteDispersionFunctions)
+    {
+      if(element->computeSoluteDispDeriv[variable - 1][slot] == f.function)
+        return f.flux;
+    }
+  }
+
+  return DispersionSelf;
+}
+
+bool ElementFluxKernels::isInteriorFace(int elementIndex, int variable) const
+{
+  if(!m_faceAssembly)
+    return false;
+
+  const ElementStateStore &state = *m_state;
+  int up = state.upstreamElement[elementIndex];
+
+  return up > -1 && state.downstreamElement[up] == elementIndex &&
+      dispersionFluxType((*m_elements)[elementIndex], variable, 0) == DispersionUpNeighbour &&
+      dispersionFluxType((*m_elements)[up], variable, 1) == DispersionDownNeighbour;
+}
+
+void ElementFluxKernels::computeElementFunctionGroup(int variable, int slot, const std::vector<int> &faces,
+                                                     const double y[], double fluxes[], double downstreamFluxes[])
+{
+  const ElementStateStore &state = *m_state;
+  const vector<Element*> &elements = *m_elements;
+  const int *elementIndexes = faces.data();
+  int numFaces = faces.size();
+
+  //The element advection functions take a mutable state vector but do not modify it.
+  //Their time step argument is unused.
+  double *Y = const_cast<double*>(y);
+
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+  for(int k = 0; k < numFaces; k++)
+  {
+    int i = elementIndexes[k];
+    Element *element = elements[i];
+
+    double faceFlux = variable == 0 ? (*element->computeTempAdvDeriv[slot])(element, 0.0, Y) :
+                                      (*element->computeSoluteAdvDeriv[variable - 1][slot])(element, 0.0, Y, variable - 1);
+    fluxes[i] = faceFlux;
+
+    if(downstreamFluxes)
+    {
+      downstreamFluxes[state.upstreamElement[i]] = -faceFlux;
+    }
+  }
+}
+
+void ElementFluxKernels::computeFluxes(int variable, bool heat, const double y[])
+{
+  const ElementStateStore &state = *m_state;
+  FaceVariable var;
+
+  if(variable == 0)
+  {
+    var.index = state.tIndex.data();
+    var.upstreamJunctionIndex = state.upstreamJunctionTIndex.data();
+    var.downstreamJunctionIndex = state.downstreamJunctionTIndex.data();
+    var.upstreamJunctionValue = state.upstreamJunctionTemperature.data();
+    var.downstreamJunctionValue = state.downstreamJunctionTemperature.data();
+  }
+  else
+  {
+    int j = variable - 1;
+    var.index = state.sIndex[j].data();
+    var.upstreamJunctionIndex = state.upstreamJunctionSIndex[j].data();
+    var.downstreamJunctionIndex = state.downstreamJunctionSIndex[j].data();
+    var.upstreamJunctionValue = state.upstreamJunctionSoluteConcs[j].data();
+    var.downstreamJunctionValue = state.downstreamJunctionSoluteConcs[j].data();
+  }
+
+  double *advectionFluxes[2] = {m_advectionFluxes[variable * 2].data(), m_advectionFluxes[variable * 2 + 1].data()};
+  double *dispersionFluxes[2] = {m_dispersionFluxes[variable * 2].data(), m_dispersionFluxes[variable * 2 + 1].data()};
+
+  //Each group writes a disjoint set of face fluxes so the groups are not synchronized.
+  //The callers place a barrier before the fluxes are read.
+  {
+    for(int slot = 0; slot < 2; slot++)
+    {
+      for(int flux = 0; flux < NumAdvectionFluxes; flux++)
+      {
+        const vector<int> &faces = m_advectionFaces[groupIndex(variable, slot, flux, NumAdvectionFluxes)];
+
+        if(faces.empty())
+          continue;
+
+        if(flux == ElementFunction)
+          computeElementFunctionGroup(variable, slot, faces, y, advectionFluxes[slot], nullptr);
+        else if(heat)
+          computeAdvectionGroup<true, false>(flux, state, var, faces, y, advectionFluxes[slot], nullptr);
+        else
+          computeAdvectionGroup<false, false>(flux, state, var, faces, y, advectionFluxes[slot], nullptr);
+      }
+
+      for(int flux = 0; flux < NumDispersionFluxes; flux++)
+      {
+        const vector<int> &faces = m_dispersionFaces[groupIndex(variable, slot, flux, NumDispersionFluxes)];
+
+        if(faces.empty())
+          continue;
+
+        if(heat)
+          computeDispersionGroup<true, false>(flux, state, var, faces, y, dispersionFluxes[slot], nullptr);
+        else
+          computeDispersionGroup<false, false>(flux, state, var, faces, y, dispersionFluxes[slot], nullptr);
+      }
+    }
+
+    //Interior faces computed once and scattered to both neighbours
+    for(int flux = 0; flux < NumAdvectionFluxes; flux++)
+    {
+      const vector<int> &faces = m_interiorAdvectionFaces[variable * NumAdvectionFluxes + flux];
+
+      if(faces.empty())
+        continue;
+
+      if(flux == ElementFunction)
+        computeElementFunctionGroup(variable, 0, faces, y, advectionFluxes[0], advectionFluxes[1]);
+      else if(heat)
+        computeAdvectionGroup<true, true>(flux, state, var, faces, y, advectionFluxes[0], advectionFluxes[1]);
+      else
+        computeAdvectionGroup<false, true>(flux, state, var, faces, y, advectionFluxes[0], advectionFluxes[1]);
+    }
+
+    for(int flux = 0; flux < NumDispersionFluxes; flux++)
+    {
+      const vector<int> &faces = m_interiorDispersionFaces[variable * NumDispersionFluxes + flux];
+
+      if(faces.empty())
+        continue;
+
+      if(heat)
+        computeDispersionGroup<true, true>(flux, state, var, faces, y, dispersionFluxes[0], dispersionFluxes[1]);
+      else
+        computeDispersionGroup<false, true>(flux, state, var, faces, y, dispersionFluxes[0], dispersionFluxes[1]);
+    }
+  }
+}
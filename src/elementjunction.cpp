@@ -39,12 +39,6 @@ ElementJunction::ElementJunction(const std::string &id, double x, double y, doub
 
 ElementJunction::~ElementJunction()
 {
-  if(soluteConcs)
-  {
-    delete[] soluteConcs;
-    delete[] prevSoluteConcs;
-  }
-
   while (outgoingElements.size())
   {
     Element *element = *outgoingElements.begin();
@@ -70,17 +64,17 @@ void ElementJunction::interpTemp()
   double sum_x = 0;
   double tempTemp = 0;
 
-  if(incomingElements.size() > 0)
+  if(incoming.size() > 0)
   {
-    for(Element *element : this->incomingElements)
+    for(Element *element : this->incoming)
     {
       tempTemp += element->temperature.value / element->length / 2.0;
       sum_x += 1.0 / element->length / 2.0;
     }
   }
-  else if(outgoingElements.size() > 0)
+  else if(outgoing.size() > 0)
   {
-    for(Element *element : this->outgoingElements)
+    for(Element *element : this->outgoing)
     {
       tempTemp += element->temperature.value / element->length / 2.0;
       sum_x += 1.0 / element->length / 2.0;
@@ -101,17 +95,17 @@ void ElementJunction::interpSoluteConcs(int soluteIndex)
   double sum_S_x = 0;
   double sum_x = 0;
 
-  if(incomingElements.size() > 0)
+  if(incoming.size() > 0)
   {
-    for(Element *element : this->incomingElements)
+    for(Element *element : this->incoming)
     {
       sum_S_x += element->soluteConcs[soluteIndex].value / element->length / 2.0;
       sum_x += 1.0 / element->length / 2.0;
     }
   }
-  else if(outgoingElements.size() > 0)
+  else if(outgoing.size() > 0)
   {
-    for(Element *element : this->outgoingElements)
+    for(Element *element : this->outgoing)
     {
       sum_S_x += element->soluteConcs[soluteIndex].value / element->length / 2.0;
       sum_x += 1.0 / element->length / 2.0;
@@ -131,14 +125,14 @@ void ElementJunction::solveHeatContinuity(double dt)
   double sumQ = 0.0;
   double sumQT = 0.0;
 
-  for(Element *incomingElement : incomingElements)
+  for(Element *incomingElement : incoming)
   {
     double q = std::max(0.0 , incomingElement->flow.value );
     sumQ += q;
     sumQT += q * incomingElement->temperature.value;
   }
 
-  for(Element *outgoingElement : outgoingElements)
+  for(Element *outgoingElement : outgoing)
   {
     double q = fabs(std::min(0.0 , outgoingElement->flow.value ));
     sumQ += q;
@@ -154,14 +148,14 @@ void ElementJunction::solveSoluteContinuity(int soluteIndex, double dt)
   double sumQ = 0.0;
   double sumQT = 0.0;
 
-  for(Element *incomingElement : incomingElements)
+  for(Element *incomingElement : incoming)
   {
     double q = std::max(0.0 , incomingElement->flow.value );
     sumQ += q;
     sumQT += q * incomingElement->soluteConcs[soluteIndex].value;
   }
 
-  for(Element *outgoingElement : outgoingElements)
+  for(Element *outgoingElement : outgoing)
   {
     double q = fabs(std::min(0.0 , outgoingElement->flow.value ));
     sumQ += q;
@@ -176,7 +170,7 @@ double ElementJunction::computeDTDt(double dt, double T[])
 {
   double DTDt = 0.0;
 
-  for(Element *element : this->incomingElements)
+  for(Element *element : this->incoming)
   {
     DTDt += element->rho_cp * element->flow.value  * T[element->tIndex] / (element->rho_cp * volume);
 
@@ -185,7 +179,7 @@ double ElementJunction::computeDTDt(double dt, double T[])
             (element->length / 2.0)) / (element->rho_cp * volume);
   }
 
-  for(Element *element : this->outgoingElements)
+  for(Element *element : this->outgoing)
   {
     DTDt -= element->rho_cp * element->flow.value  * T[element->tIndex] / (element->rho_cp * volume);
 
@@ -203,7 +197,7 @@ double ElementJunction::computeDSoluteDt(double dt, double S[], int soluteIndex)
 {
   double DSoluteDt = 0.0;
 
-  for(Element *element : this->incomingElements)
+  for(Element *element : this->incoming)
   {
     DSoluteDt += element->flow.value  * S[element->sIndex[soluteIndex]] / ( volume);
 
@@ -212,7 +206,7 @@ double ElementJunction::computeDSoluteDt(double dt, double S[], int soluteIndex)
             (element->length / 2.0)) / volume;
   }
 
-  for(Element *element : this->outgoingElements)
+  for(Element *element : this->outgoing)
   {
     DSoluteDt -= element->flow.value  * S[element->sIndex[soluteIndex]] / ( volume);
 
@@ -238,19 +232,17 @@ void ElementJunction::copyVariablesToPrev()
 
 void ElementJunction::initializeSolutes()
 {
-  if(soluteConcs)
-  {
-    delete[] soluteConcs; soluteConcs = nullptr;
-    delete[] prevSoluteConcs; prevSoluteConcs = nullptr;
-    delete[] sIndex; sIndex = nullptr;
-  }
+  //The arrays belong to the arena of the model
+  soluteConcs = nullptr;
+  prevSoluteConcs = nullptr;
+  sIndex = nullptr;
 
   if(model->m_solutes.size() > 0 )
   {
     numSolutes = model->m_solutes.size();
-    soluteConcs = new Variable[numSolutes];
-    prevSoluteConcs = new Variable[numSolutes];
-    sIndex = new int[numSolutes]();
+    soluteConcs = model->m_arena.allocate<Variable>(numSolutes);
+    prevSoluteConcs = model->m_arena.allocate<Variable>(numSolutes);
+    sIndex = model->m_arena.allocate<int>(numSolutes);
 
     for(int i = 0 ; i < numSolutes; i++)
     {
@@ -266,12 +258,12 @@ void ElementJunction::computeDerivedHydraulics()
   {
     prev_volume = volume = 0;
 
-    for(Element *element : this->outgoingElements)
+    for(Element *element : this->outgoing)
     {
       volume += element->xSectionArea * element->length / 2.0;
     }
 
-    for(Element *element : this->incomingElements)
+    for(Element *element : this->incoming)
     {
       volume += element->xSectionArea * element->length / 2.0;
     }
@@ -288,12 +280,12 @@ void ElementJunction::computeDerivedHydraulics()
     prev_volume = volume;
     volume = 0.0;
 
-    for(Element *element : this->outgoingElements)
+    for(Element *element : this->outgoing)
     {
       volume += element->xSectionArea * element->length / 2.0;
     }
 
-    for(Element *element : this->incomingElements)
+    for(Element *element : this->incoming)
     {
       volume += element->xSectionArea * element->length / 2.0;
     }
@@ -310,7 +302,7 @@ void ElementJunction::computeInflow()
   {
     inflow.value = 0;
 
-    for(Element *element : this->incomingElements)
+    for(Element *element : this->incoming)
     {
       inflow.value += element->flow.value;
     }
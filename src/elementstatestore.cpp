@@ -0,0 +1,272 @@
+/*!
+*  \file    elementstatestore.cpp
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#include "stdafx.h"
+#include "elementstatestore.h"
+#include "element.h"
+#include "elementjunction.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+ElementStateStore::ElementStateStore()
+  : numElements(0),
+    numSolutes(0),
+    forcingWeight(-1.0)
+{
+}
+
+void ElementStateStore::initialize(const std::vector<Element*> &elements, int numSolutes)
+{
+  this->numElements = elements.size();
+  this->numSolutes = numSolutes;
+
+  tIndex.assign(numElements, -1);
+  sIndex.assign(numSolutes, std::vector<int>(numElements, -1));
+  upstreamElement.assign(numElements, -1);
+  downstreamElement.assign(numElements, -1);
+  upstreamJunctionTIndex.assign(numElements, -1);
+  downstreamJunctionTIndex.assign(numElements, -1);
+  upstreamJunctionSIndex.assign(numSolutes, std::vector<int>(numElements, -1));
+  downstreamJunctionSIndex.assign(numSolutes, std::vector<int>(numElements, -1));
+
+  firstTouchAssign(inverseHalfLength, numElements, 0.0);
+  firstTouchAssign(upstreamInverseDistance, numElements, 0.0);
+  firstTouchAssign(downstreamInverseDistance, numElements, 0.0);
+  firstTouchAssign(upstreamNeighbourWeight, numElements, 0.0);
+  firstTouchAssign(upstreamCenterWeight, numElements, 0.0);
+  firstTouchAssign(downstreamNeighbourWeight, numElements, 0.0);
+  firstTouchAssign(downstreamCenterWeight, numElements, 0.0);
+  firstTouchAssign(flow, numElements, 0.0);
+  firstTouchAssign(volume, numElements, 0.0);
+  firstTouchAssign(sol_volume, numElements, 0.0);
+  firstTouchAssign(dvolume_dt, numElements, 0.0);
+  firstTouchAssign(rho_cp, numElements, 0.0);
+  firstTouchAssign(rho_cp_vol, numElements, 0.0);
+  firstTouchAssign(upstreamXSectionArea, numElements, 0.0);
+  firstTouchAssign(downstreamXSectionArea, numElements, 0.0);
+  firstTouchAssign(upstreamLongDispersion, numElements, 0.0);
+  firstTouchAssign(downstreamLongDispersion, numElements, 0.0);
+  firstTouchAssign(upstreamPecletNumber, numElements, 0.0);
+  firstTouchAssign(downstreamPecletNumber, numElements, 0.0);
+  firstTouchAssign(heatSources, numElements, 0.0);
+  firstTouchAssign(upstreamJunctionTemperature, numElements, 0.0);
+  firstTouchAssign(downstreamJunctionTemperature, numElements, 0.0);
+
+  upstreamJunctionSoluteConcs.resize(numSolutes);
+  downstreamJunctionSoluteConcs.resize(numSolutes);
+  soluteConcs.resize(numSolutes);
+  externalSoluteFluxes.resize(numSolutes);
+
+  for(int j = 0; j < numSolutes; j++)
+  {
+    firstTouchAssign(upstreamJunctionSoluteConcs[j], numElements, 0.0);
+    firstTouchAssign(downstreamJunctionSoluteConcs[j], numElements, 0.0);
+    firstTouchAssign(soluteConcs[j], numElements, 0.0);
+    firstTouchAssign(externalSoluteFluxes[j], numElements, 0.0);
+  }
+
+  forcingWeight = -1.0;
+  startForcing.clear();
+  endForcing.clear();
+
+  for(int i = 0; i < numElements; i++)
+  {
+    Element *element = elements[i];
+
+    tIndex[i] = element->tIndex;
+    upstreamElement[i] = element->upstreamElement ? element->upstreamElement->index : -1;
+    downstreamElement[i] = element->downstreamElement ? element->downstreamElement->index : -1;
+    upstreamJunctionTIndex[i] = element->upstreamJunction->tIndex;
+    downstreamJunctionTIndex[i] = element->downstreamJunction->tIndex;
+    inverseHalfLength[i] = 2.0 / element->length;
+    upstreamInverseDistance[i] = 1.0 / element->upstreamDistance;
+    downstreamInverseDistance[i] = 1.0 / element->downstreamDistance;
+    upstreamNeighbourWeight[i] = element->upstreamNeighbourWeight;
+    upstreamCenterWeight[i] = element->upstreamCenterWeight;
+    downstreamNeighbourWeight[i] = element->downstreamNeighbourWeight;
+    downstreamCenterWeight[i] = element->downstreamCenterWeight;
+
+    for(int j = 0; j < numSolutes; j++)
+    {
+      sIndex[j][i] = element->sIndex[j];
+      upstreamJunctionSIndex[j][i] = element->upstreamJunction->sIndex[j];
+      downstreamJunctionSIndex[j][i] = element->downstreamJunction->sIndex[j];
+    }
+  }
+}
+
+void ElementStateStore::update(const std::vector<Element*> &elements)
+{
+#ifdef USE_OPENMP
+#pragma omp for schedule(static)
+#endif
+  for(int i = 0; i < numElements; i++)
+  {
+    Element *element = elements[i];
+
+    flow[i] = element->flow.value;
+    volume[i] = element->volume;
+    sol_volume[i] = element->sol_volume;
+    dvolume_dt[i] = element->dvolume_dt.value;
+    rho_cp[i] = element->rho_cp;
+    rho_cp_vol[i] = element->rho_cp_vol;
+    upstreamXSectionArea[i] = element->upstreamXSectionArea;
+    downstreamXSectionArea[i] = element->downstreamXSectionArea;
+    upstreamLongDispersion[i] = element->upstreamLongDispersion;
+    downstreamLongDispersion[i] = element->downstreamLongDispersion;
+    upstreamPecletNumber[i] = element->upstreamPecletNumber;
+    downstreamPecletNumber[i] = element->downstreamPecletNumber;
+    upstreamJunctionTemperature[i] = element->upstreamJunction->temperature.value;
+    downstreamJunctionTemperature[i] = element->downstreamJunction->temperature.value;
+
+    heatSources[i] = (element->radiationFluxes * element->top_area +
+                      element->externalHeatFluxes +
+                      element->evaporationHeatFlux * element->top_area +
+                      element->convectionHeatFlux * element->top_area +
+                      element->fluidFrictionHeatFlux * element->top_area) / element->rho_cp_vol;
+
+    for(int j = 0; j < numSolutes; j++)
+    {
+      upstreamJunctionSoluteConcs[j][i] = element->upstreamJunction->soluteConcs[j].value;
+      downstreamJunctionSoluteConcs[j][i] = element->downstreamJunction->soluteConcs[j].value;
+      soluteConcs[j][i] = element->soluteConcs[j].value;
+      externalSoluteFluxes[j][i] = element->externalSoluteFluxes[j];
+    }
+  }
+}
+
+void ElementStateStore::updateHydraulics(const Element *element)
+{
+  int i = element->index;
+  flow[i] = element->flow.value;
+  volume[i] = element->volume;
+  sol_volume[i] = element->sol_volume;
+}
+
+bool ElementStateStore::updateForcingInterval(bool restart, double tolerance, double floor)
+{
+  std::vector<FirstTouchVector<double>*> arrays = forcingArrays();
+  size_t size = arrays.size() * numElements;
+
+  restart = restart || endForcing.size() != size;
+
+  startForcing.swap(endForcing);
+  endForcing.resize(size);
+
+  for(size_t k = 0; k < arrays.size(); k++)
+  {
+    std::copy(arrays[k]->begin(), arrays[k]->end(), endForcing.begin() + k * numElements);
+  }
+
+  forcingWeight = -1.0;
+
+  if(restart)
+  {
+    startForcing = endForcing;
+    forcingScales.assign(arrays.size(), 0.0);
+  }
+
+  //A step change such as a boundary condition switching over within the interval. Changes are measured against the
+  //largest magnitude the whole array reached up to the start of the interval since values like the net heat sources
+  //cross zero every day.
+  bool discontinuous = false;
+
+  for(size_t k = 0; k < arrays.size(); k++)
+  {
+    const double *start = startForcing.data() + k * numElements;
+    const double *end = endForcing.data() + k * numElements;
+    double scale = 0.0, change = 0.0;
+
+#ifdef USE_OPENMP
+#pragma omp parallel
+#endif
+    {
+      double threadScale = 0.0, threadChange = 0.0;
+
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+      for(int i = 0; i < numElements; i++)
+      {
+        threadScale = std::max(threadScale, fabs(start[i]));
+        threadChange = std::max(threadChange, fabs(end[i] - start[i]));
+      }
+
+#ifdef USE_OPENMP
+#pragma omp critical (ForcingScale)
+#endif
+      {
+        scale = std::max(scale, threadScale);
+        change = std::max(change, threadChange);
+      }
+    }
+
+    forcingScales[k] = std::max(forcingScales[k], scale);
+    discontinuous = discontinuous || change > tolerance * (forcingScales[k] + floor);
+  }
+
+  return discontinuous && !restart;
+}
+
+void ElementStateStore::interpolateForcing(double weight)
+{
+  if(weight == forcingWeight || startForcing.empty())
+    return;
+
+  std::vector<FirstTouchVector<double>*> arrays = forcingArrays();
+  int numArrays = arrays.size();
+  const double *start = startForcing.data();
+  const double *end = endForcing.data();
+
+  //One loop over the elements fills all the arrays so each right hand side evaluation opens a single parallel region
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for(int i = 0; i < numElements; i++)
+  {
+    for(int k = 0; k < numArrays; k++)
+    {
+      int index = k * numElements + i;
+      (*arrays[k])[i] = start[index] + weight * (end[index] - start[index]);
+    }
+  }
+
+  forcingWeight = weight;
+}
+
+std::vector<FirstTouchVector<double>*> ElementStateStore::forcingArrays()
+{
+  std::vector<FirstTouchVector<double>*> arrays = {&heatSources, &upstreamJunctionTemperature, &downstreamJunctionTemperature};
+
+  for(int j = 0; j < numSolutes; j++)
+  {
+    arrays.push_back(&upstreamJunctionSoluteConcs[j]);
+    arrays.push_back(&downstreamJunctionSoluteConcs[j]);
+    arrays.push_back(&externalSoluteFluxes[j]);
+  }
+
+  return arrays;
+}
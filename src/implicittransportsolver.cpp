@@ -0,0 +1,396 @@
+/*!
+*  \file    implicittransportsolver.cpp
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#include "stdafx.h"
+#include "implicittransportsolver.h"
+
+#ifdef USE_CVODE
+
+#include <sunlinsol/sunlinsol_spgmr.h>
+#include <sunlinsol/sunlinsol_spfgmr.h>
+#include <sunlinsol/sunlinsol_spbcgs.h>
+#include <sunlinsol/sunlinsol_sptfqmr.h>
+#include <sunlinsol/sunlinsol_pcg.h>
+
+#include <algorithm>
+
+using namespace std;
+
+ImplicitTransportSolver::ImplicitTransportSolver(int size, ODESolver::LinearSolverType linearSolverType)
+  : m_size(size),
+    m_linearSolverType(linearSolverType),
+    m_absoluteTolerance(1e-8),
+    m_relativeTolerance(1e-6),
+    m_iterations(0),
+    m_maxIterations(10000),
+    m_reinitializations(0),
+    m_currentTime(0.0),
+    m_derivativeFunction(nullptr),
+    m_jacobianSetupFunction(nullptr),
+    m_jacobianTimesVectorFunction(nullptr),
+    m_preconditionerSetupFunction(nullptr),
+    m_preconditionerSolveFunction(nullptr),
+    m_userData(nullptr),
+#if SUNDIALS_VERSION_MAJOR >= 6
+    m_context(nullptr),
+#endif
+    m_cvodeMemory(nullptr),
+    m_values(nullptr),
+    m_linearSolver(nullptr),
+    m_cvodeInitialized(false),
+    m_continuous(false),
+    m_reinitialize(false)
+{
+}
+
+ImplicitTransportSolver::~ImplicitTransportSolver()
+{
+  if(m_cvodeMemory)
+    CVodeFree(&m_cvodeMemory);
+
+  if(m_linearSolver)
+    SUNLinSolFree(m_linearSolver);
+
+  if(m_values)
+    N_VDestroy_Serial(m_values);
+
+#if SUNDIALS_VERSION_MAJOR >= 6
+  if(m_context)
+    SUNContext_Free(&m_context);
+#endif
+}
+
+void ImplicitTransportSolver::setTolerances(double absoluteTolerance, double relativeTolerance)
+{
+  m_absoluteTolerance = absoluteTolerance;
+  m_relativeTolerance = relativeTolerance;
+}
+
+void ImplicitTransportSolver::setFunctions(TransportDerivativeFunction derivativeFunction, JacobianSetupFunction jacobianSetupFunction,
+                                           JacobianTimesVectorFunction jacobianTimesVectorFunction)
+{
+  m_derivativeFunction = derivativeFunction;
+  m_jacobianSetupFunction = jacobianSetupFunction;
+  m_jacobianTimesVectorFunction = jacobianTimesVectorFunction;
+}
+
+void ImplicitTransportSolver::setPreconditioner(PreconditionerSetupFunction preconditionerSetupFunction,
+                                                PreconditionerSolveFunction preconditionerSolveFunction)
+{
+  m_preconditionerSetupFunction = preconditionerSetupFunction;
+  m_preconditionerSolveFunction = preconditionerSolveFunction;
+}
+
+bool ImplicitTransportSolver::initialize()
+{
+  if(m_size <= 0 || !m_derivativeFunction)
+    return false;
+
+#if SUNDIALS_VERSION_MAJOR >= 6
+  int preconditioning = m_preconditionerSolveFunction ? SUN_PREC_LEFT : SUN_PREC_NONE;
+#else
+  int preconditioning = m_preconditionerSolveFunction ? PREC_LEFT : PREC_NONE;
+#endif
+
+#if SUNDIALS_VERSION_MAJOR >= 6
+
+#if SUNDIALS_VERSION_MAJOR >= 7
+  if(SUNContext_Create(SUN_COMM_NULL, &m_context))
+#else
+  if(SUNContext_Create(nullptr, &m_context))
+#endif
+    return false;
+
+  m_cvodeMemory = CVodeCreate(CV_BDF, m_context);
+  m_values = N_VNew_Serial(m_size, m_context);
+
+  switch (m_linearSolverType)
+  {
+    case ODESolver::LinearSolverType::FGMRES:
+      m_linearSolver = SUNLinSol_SPFGMR(m_values, preconditioning, 0, m_context);
+      break;
+    case ODESolver::LinearSolverType::Bi_CGStab:
+      m_linearSolver = SUNLinSol_SPBCGS(m_values, preconditioning, 0, m_context);
+      break;
+    case ODESolver::LinearSolverType::TFQMR:
+      m_linearSolver = SUNLinSol_SPTFQMR(m_values, preconditioning, 0, m_context);
+      break;
+    case ODESolver::LinearSolverType::PCG:
+      m_linearSolver = SUNLinSol_PCG(m_values, preconditioning, 0, m_context);
+      break;
+    default:
+      m_linearSolver = SUNLinSol_SPGMR(m_values, preconditioning, 0, m_context);
+      break;
+  }
+
+#elif SUNDIALS_VERSION_MAJOR >= 4
+
+  m_cvodeMemory = CVodeCreate(CV_BDF);
+  m_values = N_VNew_Serial(m_size);
+
+  switch (m_linearSolverType)
+  {
+    case ODESolver::LinearSolverType::FGMRES:
+      m_linearSolver = SUNLinSol_SPFGMR(m_values, preconditioning, 0);
+      break;
+    case ODESolver::LinearSolverType::Bi_CGStab:
+      m_linearSolver = SUNLinSol_SPBCGS(m_values, preconditioning, 0);
+      break;
+    case ODESolver::LinearSolverType::TFQMR:
+      m_linearSolver = SUNLinSol_SPTFQMR(m_values, preconditioning, 0);
+      break;
+    case ODESolver::LinearSolverType::PCG:
+      m_linearSolver = SUNLinSol_PCG(m_values, preconditioning, 0);
+      break;
+    default:
+      m_linearSolver = SUNLinSol_SPGMR(m_values, preconditioning, 0);
+      break;
+  }
+
+#else
+
+  m_cvodeMemory = CVodeCreate(CV_BDF, CV_NEWTON);
+  m_values = N_VNew_Serial(m_size);
+
+  switch (m_linearSolverType)
+  {
+    case ODESolver::LinearSolverType::FGMRES:
+      m_linearSolver = SUNSPFGMR(m_values, preconditioning, 0);
+      break;
+    case ODESolver::LinearSolverType::Bi_CGStab:
+      m_linearSolver = SUNSPBCGS(m_values, preconditioning, 0);
+      break;
+    case ODESolver::LinearSolverType::TFQMR:
+      m_linearSolver = SUNSPTFQMR(m_values, preconditioning, 0);
+      break;
+    case ODESolver::LinearSolverType::PCG:
+      m_linearSolver = SUNPCG(m_values, preconditioning, 0);
+      break;
+    default:
+      m_linearSolver = SUNSPGMR(m_values, preconditioning, 0);
+      break;
+  }
+
+#endif
+
+  m_cvodeInitialized = false;
+  m_reinitializations = 0;
+
+  return m_cvodeMemory && m_values && m_linearSolver;
+}
+
+void ImplicitTransportSolver::setContinuous(bool continuous)
+{
+  m_continuous = continuous;
+}
+
+bool ImplicitTransportSolver::isContinuous() const
+{
+  return m_continuous;
+}
+
+void ImplicitTransportSolver::requestReinitialization()
+{
+  m_reinitialize = true;
+}
+
+int ImplicitTransportSolver::solve(const double y[], int size, double t, double dt, double yout[], void *userData)
+{
+  m_userData = userData;
+
+  //Continue from where the last call stopped unless the caller moved the time or changed the state
+  bool reinitialize = !m_cvodeInitialized || !m_continuous || m_reinitialize || t != m_currentTime ||
+                      !std::equal(y, y + size, NV_DATA_S(m_values));
+
+  if(reinitialize)
+  {
+    std::copy(y, y + size, NV_DATA_S(m_values));
+  }
+
+  int flag = CV_SUCCESS;
+  long int numStepsBefore = 0;
+
+  if(!m_cvodeInitialized)
+  {
+    if((flag = CVodeInit(m_cvodeMemory, &ImplicitTransportSolver::computeDerivatives, t, m_values)) != CV_SUCCESS ||
+       (flag = CVodeSStolerances(m_cvodeMemory, m_relativeTolerance, m_absoluteTolerance)) != CV_SUCCESS ||
+       (flag = CVodeSetUserData(m_cvodeMemory, this)) != CV_SUCCESS ||
+       (flag = CVodeSetMaxNumSteps(m_cvodeMemory, m_maxIterations)) != CV_SUCCESS ||
+#if SUNDIALS_VERSION_MAJOR >= 4
+       (flag = CVodeSetLinearSolver(m_cvodeMemory, m_linearSolver, nullptr)) != CV_SUCCESS)
+#else
+       (flag = CVSpilsSetLinearSolver(m_cvodeMemory, m_linearSolver)) != CV_SUCCESS)
+#endif
+    {
+      return flag;
+    }
+
+#if SUNDIALS_VERSION_MAJOR >= 4
+    if(m_jacobianTimesVectorFunction &&
+       (flag = CVodeSetJacTimes(m_cvodeMemory, m_jacobianSetupFunction ? &ImplicitTransportSolver::setupJacobianTimesVector : nullptr,
+                                &ImplicitTransportSolver::computeJacobianTimesVector)) != CV_SUCCESS)
+#else
+    if(m_jacobianTimesVectorFunction &&
+       (flag = CVSpilsSetJacTimes(m_cvodeMemory, m_jacobianSetupFunction ? &ImplicitTransportSolver::setupJacobianTimesVector : nullptr,
+                                  &ImplicitTransportSolver::computeJacobianTimesVector)) != CV_SUCCESS)
+#endif
+    {
+      return flag;
+    }
+
+#if SUNDIALS_VERSION_MAJOR >= 4
+    if(m_preconditionerSolveFunction &&
+       (flag = CVodeSetPreconditioner(m_cvodeMemory, &ImplicitTransportSolver::setupPreconditioner,
+                                      &ImplicitTransportSolver::solvePreconditioner)) != CV_SUCCESS)
+#else
+    if(m_preconditionerSolveFunction &&
+       (flag = CVSpilsSetPreconditioner(m_cvodeMemory, &ImplicitTransportSolver::setupPreconditioner,
+                                        &ImplicitTransportSolver::solvePreconditioner)) != CV_SUCCESS)
+#endif
+    {
+      return flag;
+    }
+
+    m_cvodeInitialized = true;
+  }
+  else if(reinitialize)
+  {
+    if((flag = CVodeReInit(m_cvodeMemory, t, m_values)) != CV_SUCCESS)
+      return flag;
+
+    m_reinitializations++;
+  }
+  else
+  {
+    CVodeGetNumSteps(m_cvodeMemory, &numStepsBefore);
+  }
+
+  m_reinitialize = false;
+
+  realtype tout = t;
+
+  if((flag = CVodeSetStopTime(m_cvodeMemory, t + dt)) != CV_SUCCESS)
+    return flag;
+
+  flag = CVode(m_cvodeMemory, t + dt, m_values, &tout, CV_NORMAL);
+
+  long int numSteps = 0;
+  CVodeGetNumSteps(m_cvodeMemory, &numSteps);
+  m_iterations = numSteps - numStepsBefore;
+
+  if(flag < 0)
+  {
+    m_reinitialize = true;
+    return flag;
+  }
+
+  m_currentTime = t + dt;
+
+  std::copy(NV_DATA_S(m_values), NV_DATA_S(m_values) + size, yout);
+
+  return 0;
+}
+
+int ImplicitTransportSolver::getIterations() const
+{
+  return m_iterations;
+}
+
+int ImplicitTransportSolver::maxIterations() const
+{
+  return m_maxIterations;
+}
+
+void ImplicitTransportSolver::setMaxIterations(int maxIterations)
+{
+  m_maxIterations = maxIterations;
+}
+
+int ImplicitTransportSolver::getLinearIterations() const
+{
+  long int numLinearIterations = 0;
+
+  if(m_cvodeMemory)
+  {
+#if SUNDIALS_VERSION_MAJOR >= 4
+    CVodeGetNumLinIters(m_cvodeMemory, &numLinearIterations);
+#else
+    CVSpilsGetNumLinIters(m_cvodeMemory, &numLinearIterations);
+#endif
+  }
+
+  return numLinearIterations;
+}
+
+int ImplicitTransportSolver::getReinitializations() const
+{
+  return m_reinitializations;
+}
+
+int ImplicitTransportSolver::computeDerivatives(realtype t, N_Vector y, N_Vector ydot, void *userData)
+{
+  ImplicitTransportSolver *solver = (ImplicitTransportSolver*) userData;
+  solver->m_derivativeFunction(t, NV_DATA_S(y), NV_DATA_S(ydot), solver->m_userData);
+  return 0;
+}
+
+int ImplicitTransportSolver::setupJacobianTimesVector(realtype t, N_Vector y, N_Vector fy, void *userData)
+{
+  ImplicitTransportSolver *solver = (ImplicitTransportSolver*) userData;
+  solver->m_jacobianSetupFunction(t, NV_DATA_S(y), NV_DATA_S(fy), solver->m_userData);
+  return 0;
+}
+
+int ImplicitTransportSolver::computeJacobianTimesVector(N_Vector v, N_Vector Jv, realtype t, N_Vector y, N_Vector fy,
+                                                        void *userData, N_Vector tmp)
+{
+  ImplicitTransportSolver *solver = (ImplicitTransportSolver*) userData;
+  solver->m_jacobianTimesVectorFunction(t, NV_DATA_S(v), NV_DATA_S(Jv), solver->m_userData);
+  return 0;
+}
+
+int ImplicitTransportSolver::setupPreconditioner(realtype t, N_Vector y, N_Vector fy, booleantype jok, booleantype *jcurPtr,
+                                                 realtype gamma, void *userData)
+{
+  ImplicitTransportSolver *solver = (ImplicitTransportSolver*) userData;
+
+  //Recompute the Jacobian unless CVODE reports the saved one is still usable
+  if(!jok && solver->m_jacobianSetupFunction)
+    solver->m_jacobianSetupFunction(t, NV_DATA_S(y), NV_DATA_S(fy), solver->m_userData);
+
+  *jcurPtr = jok ? SUNFALSE : SUNTRUE;
+
+  if(solver->m_preconditionerSetupFunction &&
+     !solver->m_preconditionerSetupFunction(t, NV_DATA_S(y), NV_DATA_S(fy), !jok, gamma, solver->m_userData))
+  {
+    return 1;
+  }
+
+  return 0;
+}
+
+int ImplicitTransportSolver::solvePreconditioner(realtype t, N_Vector y, N_Vector fy, N_Vector r, N_Vector z,
+                                                 realtype gamma, realtype delta, int lr, void *userData)
+{
+  ImplicitTransportSolver *solver = (ImplicitTransportSolver*) userData;
+  solver->m_preconditionerSolveFunction(t, NV_DATA_S(r), NV_DATA_S(z), gamma, solver->m_userData);
+  return 0;
+}
+
+#endif // USE_CVODE
@@ -0,0 +1,83 @@
+/*!
+*  \file    modelarena.h
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#include "stdafx.h"
+#include "modelarena.h"
+
+ModelArena::ModelArena(size_t blockSize)
+  : m_blockSize(blockSize),
+    m_offset(0),
+    m_bytesAllocated(0),
+    m_currentBlock(nullptr)
+{
+}
+
+ModelArena::~ModelArena()
+{
+  clear();
+}
+
+void ModelArena::clear()
+{
+  for(char *block : m_blocks)
+  {
+    ::operator delete(block);
+  }
+
+  m_blocks.clear();
+  m_currentBlock = nullptr;
+  m_offset = 0;
+  m_bytesAllocated = 0;
+}
+
+size_t ModelArena::numBlocks() const
+{
+  return m_blocks.size();
+}
+
+size_t ModelArena::bytesAllocated() const
+{
+  return m_bytesAllocated;
+}
+
+void *ModelArena::allocateBytes(size_t size, size_t alignment)
+{
+  //Blocks come from operator new so they are aligned for any fundamental type
+  if(size > m_blockSize)
+  {
+    char *block = static_cast<char*>(::operator new(size));
+    m_blocks.push_back(block);
+    m_bytesAllocated += size;
+    return block;
+  }
+
+  size_t offset = (m_offset + alignment - 1) / alignment * alignment;
+
+  if(!m_currentBlock || offset + size > m_blockSize)
+  {
+    m_currentBlock = static_cast<char*>(::operator new(m_blockSize));
+    m_blocks.push_back(m_currentBlock);
+    m_offset = offset = 0;
+  }
+
+  m_bytesAllocated += offset - m_offset + size;
+  m_offset = offset + size;
+
+  return m_currentBlock + offset;
+}
@@ -0,0 +1,225 @@
+/*!
+*  \file    reachblockpreconditioner.cpp
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#include "stdafx.h"
+#include "reachblockpreconditioner.h"
+#include "transportjacobian.h"
+#include "elementstatestore.h"
+
+#include <algorithm>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+ReachBlockPreconditioner::ReachBlockPreconditioner()
+  : m_jacobian(nullptr)
+{
+}
+
+void ReachBlockPreconditioner::initialize(const TransportJacobian *jacobian, const ElementStateStore *state)
+{
+  const ElementStateStore &store = *state;
+  int size = jacobian->size();
+
+  m_jacobian = jacobian;
+
+  //Elements are linked to neighbours only through DoubleElement junctions so the
+  //components of the neighbour graph are the unbranched reaches.
+  vector<vector<int>> neighbours(store.numElements);
+
+  for(int i = 0; i < store.numElements; i++)
+  {
+    int up = store.upstreamElement[i];
+    int down = store.downstreamElement[i];
+
+    if(up > -1)
+    {
+      neighbours[i].push_back(up);
+      neighbours[up].push_back(i);
+    }
+
+    if(down > -1)
+    {
+      neighbours[i].push_back(down);
+      neighbours[down].push_back(i);
+    }
+  }
+
+  for(vector<int> &adjacent : neighbours)
+  {
+    std::sort(adjacent.begin(), adjacent.end());
+    adjacent.erase(std::unique(adjacent.begin(), adjacent.end()), adjacent.end());
+  }
+
+  vector<vector<int>> reaches;
+  vector<bool> visited(store.numElements, false);
+
+  for(int pass = 0; pass < 2; pass++)
+  {
+    for(int i = 0; i < store.numElements; i++)
+    {
+      if(visited[i])
+        continue;
+
+      //Start reaches at their ends first. Closed loops are opened at an arbitrary element in the second pass.
+      if(pass == 0 && neighbours[i].size() > 1)
+        continue;
+
+      vector<int> reach;
+      int previous = -1, current = i;
+
+      while(current > -1 && !visited[current])
+      {
+        visited[current] = true;
+        reach.push_back(current);
+
+        int next = -1;
+
+        for(int neighbour : neighbours[current])
+        {
+          if(neighbour != previous && !visited[neighbour])
+          {
+            next = neighbour;
+            break;
+          }
+        }
+
+        previous = current;
+        current = next;
+      }
+
+      reaches.push_back(reach);
+    }
+  }
+
+  m_blockPointers.assign(1, 0);
+  m_unknowns.clear();
+  vector<bool> covered(size, false);
+
+  for(int v = 0; v < 1 + store.numSolutes; v++)
+  {
+    const vector<int> &index = v ? store.sIndex[v - 1] : store.tIndex;
+
+    for(const vector<int> &reach : reaches)
+    {
+      for(int i : reach)
+      {
+        m_unknowns.push_back(index[i]);
+        covered[index[i]] = true;
+      }
+
+      m_blockPointers.push_back(m_unknowns.size());
+    }
+  }
+
+  //Junction unknowns
+  for(int r = 0; r < size; r++)
+  {
+    if(!covered[r])
+    {
+      m_unknowns.push_back(r);
+      m_blockPointers.push_back(m_unknowns.size());
+    }
+  }
+
+  m_lowerPositions.assign(m_unknowns.size(), -1);
+  m_upperPositions.assign(m_unknowns.size(), -1);
+
+  for(int b = 0; b < numBlocks(); b++)
+  {
+    for(int k = m_blockPointers[b]; k < m_blockPointers[b + 1]; k++)
+    {
+      if(k > m_blockPointers[b])
+        m_lowerPositions[k] = jacobian->find(m_unknowns[k], m_unknowns[k - 1]);
+
+      if(k < m_blockPointers[b + 1] - 1)
+        m_upperPositions[k] = jacobian->find(m_unknowns[k], m_unknowns[k + 1]);
+    }
+  }
+
+  m_lower.assign(m_unknowns.size(), 0.0);
+  m_inversePivots.assign(m_unknowns.size(), 1.0);
+  m_upper.assign(m_unknowns.size(), 0.0);
+}
+
+int ReachBlockPreconditioner::numBlocks() const
+{
+  return m_blockPointers.empty() ? 0 : m_blockPointers.size() - 1;
+}
+
+bool ReachBlockPreconditioner::factorize(double gamma)
+{
+  const vector<double> &values = m_jacobian->values();
+  const vector<int> &diagonal = m_jacobian->diagonal();
+  bool factorized = true;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 16) reduction(&&:factorized)
+#endif
+  for(int b = 0; b < numBlocks(); b++)
+  {
+    double upper = 0.0;
+
+    for(int k = m_blockPointers[b]; k < m_blockPointers[b + 1]; k++)
+    {
+      double lower = m_lowerPositions[k] > -1 ? -gamma * values[m_lowerPositions[k]] : 0.0;
+      double pivot = 1.0 - gamma * values[diagonal[m_unknowns[k]]] - lower * upper;
+
+      if(pivot == 0.0)
+      {
+        factorized = false;
+        pivot = 1.0;
+      }
+
+      m_lower[k] = lower;
+      m_inversePivots[k] = 1.0 / pivot;
+      upper = m_upperPositions[k] > -1 ? -gamma * values[m_upperPositions[k]] * m_inversePivots[k] : 0.0;
+      m_upper[k] = upper;
+    }
+  }
+
+  return factorized;
+}
+
+void ReachBlockPreconditioner::solve(const double r[], double z[]) const
+{
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+  for(int b = 0; b < numBlocks(); b++)
+  {
+    int begin = m_blockPointers[b];
+    int end = m_blockPointers[b + 1];
+    double previous = 0.0;
+
+    for(int k = begin; k < end; k++)
+    {
+      previous = (r[m_unknowns[k]] - m_lower[k] * previous) * m_inversePivots[k];
+      z[m_unknowns[k]] = previous;
+    }
+
+    for(int k = end - 2; k >= begin; k--)
+    {
+      z[m_unknowns[k]] -= m_upper[k] * z[m_unknowns[k + 1]];
+    }
+  }
+}
@@ -0,0 +1,167 @@
+/*!
+*  \file    subnetworkscheduler.cpp
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#include "stdafx.h"
+#include "subnetworkscheduler.h"
+#include "elementstatestore.h"
+
+#include <algorithm>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+//Smallest subnetwork worth a task
+static const int MIN_SUBNETWORK_SIZE = 16;
+
+//Subnetworks per thread so that idle threads have work to take
+static const int SUBNETWORKS_PER_THREAD = 4;
+
+SubnetworkScheduler::SubnetworkScheduler()
+  : m_enabled(false),
+    m_numElements(0)
+{
+}
+
+void SubnetworkScheduler::initialize(const ElementStateStore *state, bool enabled)
+{
+  const ElementStateStore &store = *state;
+
+  m_enabled = enabled;
+  m_numElements = store.numElements;
+
+  vector<vector<int>> neighbours(store.numElements);
+
+  for(int i = 0; i < store.numElements; i++)
+  {
+    int up = store.upstreamElement[i];
+    int down = store.downstreamElement[i];
+
+    if(up > -1)
+    {
+      neighbours[i].push_back(up);
+      neighbours[up].push_back(i);
+    }
+
+    if(down > -1)
+    {
+      neighbours[i].push_back(down);
+      neighbours[down].push_back(i);
+    }
+  }
+
+  for(vector<int> &adjacent : neighbours)
+  {
+    std::sort(adjacent.begin(), adjacent.end());
+    adjacent.erase(std::unique(adjacent.begin(), adjacent.end()), adjacent.end());
+  }
+
+  int numThreads = 1;
+
+#ifdef USE_OPENMP
+  numThreads = omp_get_max_threads();
+#endif
+
+  int maxSize = std::max(MIN_SUBNETWORK_SIZE, (store.numElements + SUBNETWORKS_PER_THREAD * numThreads - 1) / (SUBNETWORKS_PER_THREAD * numThreads));
+
+  //Reaches are walked from one end to the other and split into pieces of at most maxSize elements
+  vector<vector<int>> pieces;
+  vector<bool> visited(store.numElements, false);
+
+  for(int pass = 0; pass < 2; pass++)
+  {
+    for(int i = 0; i < store.numElements; i++)
+    {
+      if(visited[i])
+        continue;
+
+      //Start reaches at their ends first. Closed loops are opened at an arbitrary element in the second pass.
+      if(pass == 0 && neighbours[i].size() > 1)
+        continue;
+
+      vector<int> piece;
+      int previous = -1, current = i;
+
+      while(current > -1 && !visited[current])
+      {
+        visited[current] = true;
+        piece.push_back(current);
+
+        if((int)piece.size() == maxSize)
+        {
+          pieces.push_back(piece);
+          piece.clear();
+        }
+
+        int next = -1;
+
+        for(int neighbour : neighbours[current])
+        {
+          if(neighbour != previous && !visited[neighbour])
+          {
+            next = neighbour;
+            break;
+          }
+        }
+
+        previous = current;
+        current = next;
+      }
+
+      if(piece.size())
+      {
+        pieces.push_back(piece);
+      }
+    }
+  }
+
+  //Largest pieces first so the long tasks start early. Small pieces are packed until they are worth a task.
+  std::stable_sort(pieces.begin(), pieces.end(), [](const vector<int> &a, const vector<int> &b){ return a.size() > b.size(); });
+
+  m_subnetworkPointers.assign(1, 0);
+  m_elements.clear();
+  m_elements.reserve(store.numElements);
+
+  for(const vector<int> &piece : pieces)
+  {
+    m_elements.insert(m_elements.end(), piece.begin(), piece.end());
+
+    if((int)m_elements.size() - m_subnetworkPointers.back() >= MIN_SUBNETWORK_SIZE)
+    {
+      m_subnetworkPointers.push_back(m_elements.size());
+    }
+  }
+
+  if((int)m_elements.size() > m_subnetworkPointers.back())
+  {
+    m_subnetworkPointers.push_back(m_elements.size());
+  }
+}
+
+bool SubnetworkScheduler::isEnabled() const
+{
+  return m_enabled;
+}
+
+int SubnetworkScheduler::numSubnetworks() const
+{
+  return m_subnetworkPointers.empty() ? 0 : m_subnetworkPointers.size() - 1;
+}
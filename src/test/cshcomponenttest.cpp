@@ -24,6 +24,10 @@
 #include "element.h"
 #include "variable.h"
 
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
 
 void CSHComponentTest::versteegCase1_Upwind()
 {
@@ -477,3 +481,413 @@ void CSHComponentTest::green_river_test2()
   }
 }
 
+
+void CSHComponentTest::transportJacobian_Upwind()
+{
+  compareTransportJacobian(CSHModel::Upwind, true);
+}
+
+void CSHComponentTest::transportJacobian_TVD()
+{
+  compareTransportJacobian(CSHModel::TVD, false);
+}
+
+void CSHComponentTest::transportDerivatives_Upwind()
+{
+  compareTransportDerivatives(CSHModel::Upwind);
+}
+
+void CSHComponentTest::transportDerivatives_Central()
+{
+  compareTransportDerivatives(CSHModel::Central);
+}
+
+void CSHComponentTest::transportDerivatives_Hybrid()
+{
+  compareTransportDerivatives(CSHModel::Hybrid);
+}
+
+CSHModel *CSHComponentTest::createBranchingNetwork(int advectionMode, int refinement)
+{
+  CSHModel *model = new CSHModel(nullptr);
+  model->setNumSolutes(2);
+  model->setAdvectionDiscretizationMode((CSHModel::AdvectionDiscretizationMode)advectionMode);
+  model->setComputeLongDispersion(true);
+  model->setStartDateTime(0.0);
+  model->setEndDateTime(1.0);
+  model->setOutputInterval(3600);
+  model->setMinTimeStep(0.5);
+  model->setMaxTimeStep(20.0);
+
+  //Two tributaries with boundary condition inflows joining a main stem
+  ElementJunction *upstreamA = model->addElementJunction("A0", 0, 0, 1);
+  ElementJunction *upstreamB = model->addElementJunction("B0", 0, 1000, 1);
+  ElementJunction *confluence = model->addElementJunction("C", 1000, 500, 0.5);
+  ElementJunction *outlet = model->addElementJunction("OUT", 3000, 500, 0);
+
+  upstreamA->temperature.isBC = true;
+  upstreamA->temperature.value = 20.0;
+  upstreamB->temperature.isBC = true;
+  upstreamB->temperature.value = 5.0;
+
+  for(int i = 0; i < 2; i++)
+  {
+    upstreamA->soluteConcs[i].isBC = true;
+    upstreamA->soluteConcs[i].value = 3.0 + i;
+    upstreamB->soluteConcs[i].isBC = true;
+    upstreamB->soluteConcs[i].value = 0.5;
+  }
+
+  struct Reach
+  {
+    std::string prefix;
+    ElementJunction *from, *to;
+    int numElements;
+    double flow, x0, y0, dx, dy;
+  };
+
+  std::vector<Reach> reaches = {{"A", upstreamA, confluence, 10, 1.0, 0, 0, 100, 50},
+                                {"B", upstreamB, confluence, 10, 1.5, 0, 1000, 100, -50},
+                                {"M", confluence, outlet, 15, 2.5, 1000, 500, 130, 0}};
+
+  for(const Reach &reach : reaches)
+  {
+    ElementJunction *previous = reach.from;
+    int numElements = reach.numElements * refinement;
+
+    for(int i = 0; i < numElements; i++)
+    {
+      ElementJunction *next = i == numElements - 1 ? reach.to :
+                                                     model->addElementJunction(reach.prefix + "J" + std::to_string(i),
+                                                                               reach.x0 + reach.dx * (i + 1),
+                                                                               reach.y0 + reach.dy * (i + 1),
+                                                                               -0.01 * (i + 1));
+
+      Element *element = model->addElement(reach.prefix + "E" + std::to_string(i), previous, next);
+      element->length = 80 + 40 * ((i * 7) % 5);
+      element->depth = 0.8 + 0.1 * (i % 3);
+      element->bottomWidth = 4.0;
+      element->flow.value = reach.flow;
+      element->temperature.value = 10 + (i % 4);
+      element->longDispersion.value = 0.5;
+
+      for(int j = 0; j < element->numSolutes; j++)
+        element->soluteConcs[j].value = 1.0 + j + 0.1 * i;
+
+      previous = next;
+    }
+  }
+
+  return model;
+}
+
+void CSHComponentTest::compareTransportJacobian(int advectionMode, bool analytic)
+{
+  std::list<std::string> errors;
+
+  CSHModel *model = createBranchingNetwork(advectionMode);
+
+  QVERIFY(model->initializeTimeVariables(errors) &&
+          model->initializeElements(errors) &&
+          model->initializeSolver(errors));
+
+  //Same preparation as CSHModel::update before the solve
+  model->m_timeStep = model->computeTimeStep();
+  model->computeElementPhases(false);
+  model->m_fluxKernels.classify(model->m_elements);
+  QCOMPARE(model->m_transportOperator.assemble(), analytic);
+
+  TransportJacobian &jacobian = model->m_transportJacobian;
+  jacobian.initialize(&model->m_elementState, model->m_eligibleJunctions, model->m_solverSize,
+                      advectionMode == CSHModel::TVD);
+
+  int size = model->m_solverSize;
+  std::vector<double> y(size), fy(size), yPerturbed(size), fyPerturbed(size);
+
+  for(int i = 0; i < size; i++)
+    y[i] = 5.0 + 3.0 * sin(0.37 * i);
+
+  SolverUserData userData;
+  userData.model = model;
+
+  CSHModel::computeDYDt(0.0, y.data(), fy.data(), &userData);
+  CSHModel::computeJacobian(0.0, y.data(), fy.data(), &userData);
+
+  QVERIFY(jacobian.isAssembled());
+  QCOMPARE(jacobian.isApproximate(), !analytic);
+
+  const std::vector<int> &rowPointers = jacobian.rowPointers();
+  const std::vector<int> &columns = jacobian.columns();
+  const std::vector<double> &values = jacobian.values();
+
+  std::vector<double> dense(size * size, 0.0);
+  std::vector<bool> inPattern(size * size, false);
+
+  for(int row = 0; row < size; row++)
+  {
+    for(int k = rowPointers[row]; k < rowPointers[row + 1]; k++)
+    {
+      dense[row * size + columns[k]] = values[k];
+      inPattern[row * size + columns[k]] = true;
+    }
+  }
+
+  double maxValue = 0.0;
+
+  for(double value : dense)
+    maxValue = std::max(maxValue, fabs(value));
+
+  QVERIFY(maxValue > 0.0);
+
+  double tolerance = 1e-6 * maxValue;
+
+  for(int column = 0; column < size; column++)
+  {
+    yPerturbed = y;
+    double step = sqrt(std::numeric_limits<double>::epsilon()) * std::max(fabs(y[column]), 1.0);
+    yPerturbed[column] += step;
+    step = yPerturbed[column] - y[column];
+
+    CSHModel::computeDYDt(0.0, yPerturbed.data(), fyPerturbed.data(), &userData);
+
+    for(int row = 0; row < size; row++)
+    {
+      double difference = (fyPerturbed[row] - fy[row]) / step;
+      int index = row * size + column;
+
+      QVERIFY2(inPattern[index] || fabs(difference) <= tolerance,
+               qPrintable(QString("Nonzero derivative outside the sparsity pattern at (%1, %2)").arg(row).arg(column)));
+
+      QVERIFY2(fabs(dense[index] - difference) <= tolerance,
+               qPrintable(QString("Jacobian entry (%1, %2) = %3 differs from the difference quotient %4")
+                          .arg(row).arg(column).arg(dense[index]).arg(difference)));
+    }
+  }
+
+  delete model;
+}
+
+void CSHComponentTest::compareTransportDerivatives(int advectionMode)
+{
+  std::list<std::string> errors;
+
+  CSHModel *model = createBranchingNetwork(advectionMode);
+
+  QVERIFY(model->initializeTimeVariables(errors) &&
+          model->initializeElements(errors) &&
+          model->initializeSolver(errors));
+
+  //Same preparation as CSHModel::update before the solve
+  model->m_timeStep = model->computeTimeStep();
+  model->computeElementPhases(false);
+
+  int size = model->m_solverSize;
+  std::vector<double> y(size), expected(size, 0.0);
+
+  for(int i = 0; i < size; i++)
+    y[i] = 5.0 + 3.0 * sin(0.37 * i);
+
+  //Element and junction equations evaluated one at a time
+  for(Element *element : model->m_elements)
+  {
+    expected[element->tIndex] = element->computeDTDt(0.0, y.data());
+
+    for(int j = 0; j < element->numSolutes; j++)
+      expected[element->sIndex[j]] = element->computeDSoluteDt(0.0, y.data(), j);
+  }
+
+  for(ElementJunction *junction : model->m_eligibleJunctions)
+  {
+    if(junction->junctionType == ElementJunction::MultiElement)
+    {
+      expected[junction->tIndex] = junction->computeDTDt(0.0, y.data());
+
+      for(size_t j = 0; j < model->m_solutes.size(); j++)
+        expected[junction->sIndex[j]] = junction->computeDSoluteDt(0.0, y.data(), j);
+    }
+  }
+
+  double maxValue = 0.0;
+
+  for(double value : expected)
+    maxValue = std::max(maxValue, fabs(value));
+
+  QVERIFY(maxValue > 0.0);
+
+  double tolerance = 1e-10 * maxValue;
+
+  SolverUserData userData;
+  userData.model = model;
+
+  //Flux kernels with face assembly off and on, then the linear transport operator
+  const char *paths[] = {"flux kernels", "face assembly", "transport operator"};
+
+  for(int path = 0; path < 3; path++)
+  {
+    model->m_fluxKernels.initialize(&model->m_elementState, path > 0);
+    model->m_fluxKernels.classify(model->m_elements);
+    model->m_useLinearTransportOperator = path == 2;
+
+    if(model->m_useLinearTransportOperator)
+    {
+      QVERIFY(model->m_transportOperator.assemble());
+    }
+
+    std::vector<double> dydt(size, 0.0);
+    CSHModel::computeDYDt(0.0, y.data(), dydt.data(), &userData);
+
+    for(int row = 0; row < size; row++)
+    {
+      QVERIFY2(fabs(dydt[row] - expected[row]) <= tolerance,
+               qPrintable(QString("%1 derivative %2 = %3 differs from the element equation %4")
+                          .arg(paths[path]).arg(row).arg(dydt[row]).arg(expected[row])));
+    }
+  }
+
+  delete model;
+}
+
+void CSHComponentTest::continuousForcing_Diurnal()
+{
+  std::list<std::string> errors;
+
+  CSHModel *model = createBranchingNetwork(CSHModel::Upwind);
+
+  QVERIFY(model->initializeTimeVariables(errors) &&
+          model->initializeElements(errors) &&
+          model->initializeSolver(errors));
+
+  ElementStateStore &state = model->m_elementState;
+  double tolerance = model->m_forcingDiscontinuityTolerance;
+  double floor = model->m_odeSolver->absoluteTolerance();
+  double timeStep = 3600.0;
+  const double pi = acos(-1.0);
+
+  //Two days of hourly forcing. The net heat sources cross zero and the solute fluxes switch on from zero every day.
+  for(int step = 0; step <= 48; step++)
+  {
+    double t = step * timeStep;
+
+    for(int i = 0; i < state.numElements; i++)
+    {
+      double phase = 2.0 * pi * t / 86400.0 + 0.1 * i;
+
+      state.heatSources[i] = 300.0 * sin(phase) - 50.0;
+      state.upstreamJunctionTemperature[i] = 15.0 + 5.0 * sin(phase);
+      state.downstreamJunctionTemperature[i] = 15.0 + 5.0 * sin(phase);
+
+      for(int j = 0; j < state.numSolutes; j++)
+      {
+        state.upstreamJunctionSoluteConcs[j][i] = 1.0 + 0.5 * sin(phase);
+        state.downstreamJunctionSoluteConcs[j][i] = 1.0 + 0.5 * sin(phase);
+        state.externalSoluteFluxes[j][i] = 1e-3 * std::max(sin(phase), 0.0);
+      }
+    }
+
+    QVERIFY2(!state.updateForcingInterval(step == 0, tolerance, floor),
+             qPrintable(QString("Smooth forcing restarted the integration at step %1").arg(step)));
+  }
+
+  //A boundary condition switching over within the time step
+  for(int i = 0; i < state.numElements; i++)
+  {
+    state.upstreamJunctionTemperature[i] += 15.0;
+  }
+
+  QVERIFY(state.updateForcingInterval(false, tolerance, floor));
+
+  delete model;
+}
+
+void CSHComponentTest::heatSoluteBalance_ThreadCount()
+{
+  std::list<std::string> errors;
+  const int threads[2] = {1, 4};
+  std::vector<double> balances[2], extrema[2];
+
+  for(int run = 0; run < 2; run++)
+  {
+    //Enough elements for several balance blocks
+    CSHModel *model = createBranchingNetwork(CSHModel::Upwind, 8);
+
+    for(int phase = 0; phase < CSHModel::NumParallelPhases; phase++)
+      model->m_phaseThreads[phase] = threads[run];
+
+    QVERIFY(model->initializeTimeVariables(errors) &&
+            model->initializeElements(errors) &&
+            model->initializeSolver(errors));
+
+    for(int step = 0; step < 5; step++)
+      model->update();
+
+    balances[run] = model->m_balanceTotals;
+    extrema[run] = {model->m_minTemp, model->m_maxTemp};
+    extrema[run].insert(extrema[run].end(), model->m_minSolute.begin(), model->m_minSolute.end());
+    extrema[run].insert(extrema[run].end(), model->m_maxSolute.begin(), model->m_maxSolute.end());
+
+    delete model;
+  }
+
+  QVERIFY(!balances[0].empty());
+
+  for(size_t i = 0; i < balances[0].size(); i++)
+  {
+    QVERIFY2(balances[0][i] == balances[1][i],
+             qPrintable(QString("Balance term %1 = %2 with one thread and %3 with %4 threads")
+                        .arg(i).arg(balances[0][i]).arg(balances[1][i]).arg(threads[1])));
+  }
+
+  QVERIFY(extrema[0] == extrema[1]);
+}
+
+void CSHComponentTest::elementReordering_InputOrder()
+{
+  std::list<std::string> errors;
+  std::vector<double> values[2];
+
+  for(int run = 0; run < 2; run++)
+  {
+    CSHModel *model = createBranchingNetwork(CSHModel::Upwind, 2);
+    model->m_useElementReordering = run == 1;
+
+    //Scatter the neighbours through the input order, main stem first and each reach from its downstream end
+    std::reverse(model->m_inputOrderElements.begin(), model->m_inputOrderElements.end());
+    std::reverse(model->m_inputOrderElementJunctions.begin(), model->m_inputOrderElementJunctions.end());
+
+    QVERIFY(model->initializeTimeVariables(errors) &&
+            model->initializeElements(errors) &&
+            model->initializeSolver(errors));
+
+    QCOMPARE(model->m_elements != model->m_inputOrderElements, model->m_useElementReordering);
+
+    for(int step = 0; step < 5; step++)
+      model->update();
+
+    for(Element *element : model->m_inputOrderElements)
+    {
+      values[run].push_back(element->temperature.value);
+
+      for(int j = 0; j < element->numSolutes; j++)
+        values[run].push_back(element->soluteConcs[j].value);
+    }
+
+    for(ElementJunction *junction : model->m_inputOrderElementJunctions)
+    {
+      values[run].push_back(junction->temperature.value);
+
+      for(size_t j = 0; j < model->m_solutes.size(); j++)
+        values[run].push_back(junction->soluteConcs[j].value);
+    }
+
+    delete model;
+  }
+
+  QCOMPARE(values[0].size(), values[1].size());
+
+  for(size_t i = 0; i < values[0].size(); i++)
+  {
+    QVERIFY2(values[0][i] == values[1][i],
+             qPrintable(QString("Value %1 in input order is %2 and %3 after reordering")
+                        .arg(i).arg(values[0][i]).arg(values[1][i])));
+  }
+}
@@ -0,0 +1,457 @@
+/*!
+*  \file    transportjacobian.cpp
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#include "stdafx.h"
+#include "transportjacobian.h"
+#include "transportoperator.h"
+#include "elementstatestore.h"
+#include "element.h"
+#include "elementjunction.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+TransportJacobian::TransportJacobian()
+  : m_state(nullptr),
+    m_size(0),
+    m_initialized(false),
+    m_assembled(false),
+    m_approximate(false)
+{
+}
+
+void TransportJacobian::initialize(const ElementStateStore *state, const std::vector<ElementJunction*> &junctions, int size, bool secondNeighbours)
+{
+  const ElementStateStore &store = *state;
+
+  m_state = state;
+  m_size = size;
+  m_assembled = false;
+  m_approximate = false;
+  m_junctions.clear();
+
+  vector<vector<int>> rows(size);
+
+  //Element rows
+  for(int v = 0; v < 1 + store.numSolutes; v++)
+  {
+    const vector<int> &index = v ? store.sIndex[v - 1] : store.tIndex;
+    const vector<int> &upstreamJunctionIndex = v ? store.upstreamJunctionSIndex[v - 1] : store.upstreamJunctionTIndex;
+    const vector<int> &downstreamJunctionIndex = v ? store.downstreamJunctionSIndex[v - 1] : store.downstreamJunctionTIndex;
+
+    for(int i = 0; i < store.numElements; i++)
+    {
+      vector<int> &row = rows[index[i]];
+      int up = store.upstreamElement[i];
+      int down = store.downstreamElement[i];
+
+      row.push_back(index[i]);
+      row.push_back(upstreamJunctionIndex[i]);
+      row.push_back(downstreamJunctionIndex[i]);
+
+      if(up > -1)
+      {
+        row.push_back(index[up]);
+
+        if(secondNeighbours)
+        {
+          row.push_back(upstreamJunctionIndex[up]);
+
+          if(store.upstreamElement[up] > -1)
+            row.push_back(index[store.upstreamElement[up]]);
+        }
+      }
+
+      if(down > -1)
+      {
+        row.push_back(index[down]);
+
+        if(secondNeighbours)
+        {
+          row.push_back(downstreamJunctionIndex[down]);
+
+          if(store.downstreamElement[down] > -1)
+            row.push_back(index[store.downstreamElement[down]]);
+        }
+      }
+    }
+  }
+
+  //Junction rows
+  for(ElementJunction *junction : junctions)
+  {
+    if(junction->junctionType != ElementJunction::MultiElement)
+      continue;
+
+    m_junctions.push_back(junction);
+
+    for(int v = 0; v < 1 + store.numSolutes; v++)
+    {
+      int self = v ? junction->sIndex[v - 1] : junction->tIndex;
+
+      if(self < 0)
+        continue;
+
+      vector<int> &row = rows[self];
+      row.push_back(self);
+
+      for(Element *element : junction->incoming)
+        row.push_back(v ? element->sIndex[v - 1] : element->tIndex);
+
+      for(Element *element : junction->outgoing)
+        row.push_back(v ? element->sIndex[v - 1] : element->tIndex);
+    }
+  }
+
+  m_rowPointers.assign(size + 1, 0);
+  m_columns.clear();
+  m_diagonal.assign(size, -1);
+
+  for(int r = 0; r < size; r++)
+  {
+    vector<int> &row = rows[r];
+    row.push_back(r);
+    row.erase(std::remove_if(row.begin(), row.end(), [](int column){ return column < 0; }), row.end());
+    std::sort(row.begin(), row.end());
+    row.erase(std::unique(row.begin(), row.end()), row.end());
+
+    for(int column : row)
+    {
+      if(column == r)
+        m_diagonal[r] = m_columns.size();
+
+      m_columns.push_back(column);
+    }
+
+    m_rowPointers[r + 1] = m_columns.size();
+  }
+
+  m_values.assign(m_columns.size(), 0.0);
+
+  //Transpose of the pattern for the difference quotients
+  m_columnPointers.assign(size + 1, 0);
+  m_columnEntries.assign(m_columns.size(), -1);
+  m_columnRows.assign(m_columns.size(), -1);
+
+  for(int column : m_columns)
+    m_columnPointers[column + 1]++;
+
+  for(int c = 0; c < size; c++)
+    m_columnPointers[c + 1] += m_columnPointers[c];
+
+  vector<int> next(m_columnPointers.begin(), m_columnPointers.end() - 1);
+
+  for(int r = 0; r < size; r++)
+  {
+    for(int k = m_rowPointers[r]; k < m_rowPointers[r + 1]; k++)
+    {
+      int position = next[m_columns[k]]++;
+      m_columnEntries[position] = k;
+      m_columnRows[position] = r;
+    }
+  }
+
+  //Greedy grouping of columns that do not share a row
+  vector<int> columnGroup(size, -1);
+  vector<int> groupUsedBy;
+  int numGroups = 0;
+
+  for(int c = 0; c < size; c++)
+  {
+    for(int p = m_columnPointers[c]; p < m_columnPointers[c + 1]; p++)
+    {
+      int r = m_columnRows[p];
+
+      for(int k = m_rowPointers[r]; k < m_rowPointers[r + 1]; k++)
+      {
+        int group = columnGroup[m_columns[k]];
+
+        if(group > -1)
+          groupUsedBy[group] = c;
+      }
+    }
+
+    int group = 0;
+
+    while(group < numGroups && groupUsedBy[group] == c)
+      group++;
+
+    if(group == numGroups)
+    {
+      groupUsedBy.push_back(-1);
+      numGroups++;
+    }
+
+    columnGroup[c] = group;
+  }
+
+  m_groupPointers.assign(numGroups + 1, 0);
+  m_groupColumns.assign(size, -1);
+
+  for(int c = 0; c < size; c++)
+    m_groupPointers[columnGroup[c] + 1]++;
+
+  for(int g = 0; g < numGroups; g++)
+    m_groupPointers[g + 1] += m_groupPointers[g];
+
+  next.assign(m_groupPointers.begin(), m_groupPointers.end() - 1);
+
+  for(int c = 0; c < size; c++)
+    m_groupColumns[next[columnGroup[c]]++] = c;
+
+  m_perturbedValues.assign(size, 0.0);
+  m_perturbedDerivatives.assign(size, 0.0);
+  m_increments.assign(size, 0.0);
+
+  m_initialized = true;
+}
+
+bool TransportJacobian::assemble(const TransportOperator &transportOperator)
+{
+  const ElementStateStore &state = *m_state;
+  const int numVariables = transportOperator.m_numVariables;
+  bool assembled = transportOperator.isAssembled() && numVariables == 1 + state.numSolutes;
+
+  m_assembled = false;
+
+  if(!assembled)
+    return false;
+
+  std::fill(m_values.begin(), m_values.end(), 0.0);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(&&:assembled)
+#endif
+  for(int i = 0; i < state.numElements; i++)
+  {
+    for(int v = 0; v < numVariables; v++)
+    {
+      bool heat = v == 0;
+      int row = heat ? state.tIndex[i] : state.sIndex[v - 1][i];
+
+      //Rows of dry elements are not integrated
+      if(heat ? state.volume[i] <= 1e-12 : state.volume[i] <= 1e-18)
+        continue;
+
+      for(int k = transportOperator.m_rowPointers[i]; k < transportOperator.m_rowPointers[i + 1]; k++)
+      {
+        int column = transportOperator.m_columnIndexes[transportOperator.m_columns[k] * numVariables + v];
+
+        //Junction boundary values are constant
+        if(column < 0)
+          continue;
+
+        int position = find(row, column);
+
+        if(position < 0)
+        {
+          assembled = false;
+          continue;
+        }
+
+        m_values[position] += heat ? transportOperator.m_heatValues[k] : transportOperator.m_soluteValues[k];
+      }
+
+      //Product rule volume derivative
+      m_values[m_diagonal[row]] -= state.dvolume_dt[i] / (heat ? state.volume[i] : state.sol_volume[i]);
+    }
+  }
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for(int i = 0; i < (int)m_junctions.size(); i++)
+  {
+    const ElementJunction *junction = m_junctions[i];
+
+    for(int v = 0; v < 1 + state.numSolutes; v++)
+    {
+      int row = v ? junction->sIndex[v - 1] : junction->tIndex;
+
+      if(row > -1)
+        addJunctionRow(junction, row, v);
+    }
+  }
+
+  m_assembled = assembled;
+  m_approximate = false;
+
+  return m_assembled;
+}
+
+void TransportJacobian::assemble(TransportDerivativeFunction function, void *userData, double t, const double y[], const double fy[])
+{
+  const double sqrtEpsilon = sqrt(DBL_EPSILON);
+  double *perturbedValues = m_perturbedValues.data();
+  double *perturbedDerivatives = m_perturbedDerivatives.data();
+
+  std::copy(y, y + m_size, perturbedValues);
+
+  for(int g = 0; g < (int)m_groupPointers.size() - 1; g++)
+  {
+    for(int p = m_groupPointers[g]; p < m_groupPointers[g + 1]; p++)
+    {
+      int c = m_groupColumns[p];
+      double increment = sqrtEpsilon * std::max(fabs(y[c]), 1.0);
+      perturbedValues[c] = y[c] + increment;
+      m_increments[c] = perturbedValues[c] - y[c];
+    }
+
+    function(t, perturbedValues, perturbedDerivatives, userData);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+    for(int p = m_groupPointers[g]; p < m_groupPointers[g + 1]; p++)
+    {
+      int c = m_groupColumns[p];
+
+      for(int q = m_columnPointers[c]; q < m_columnPointers[c + 1]; q++)
+      {
+        int r = m_columnRows[q];
+        m_values[m_columnEntries[q]] = (perturbedDerivatives[r] - fy[r]) / m_increments[c];
+      }
+
+      perturbedValues[c] = y[c];
+    }
+  }
+
+  m_assembled = true;
+  m_approximate = true;
+}
+
+void TransportJacobian::invalidate()
+{
+  m_assembled = false;
+}
+
+bool TransportJacobian::isInitialized() const
+{
+  return m_initialized;
+}
+
+bool TransportJacobian::isAssembled() const
+{
+  return m_assembled;
+}
+
+bool TransportJacobian::isApproximate() const
+{
+  return m_approximate;
+}
+
+void TransportJacobian::multiply(const double v[], double Jv[]) const
+{
+  const int *rowPointers = m_rowPointers.data();
+  const int *columns = m_columns.data();
+  const double *values = m_values.data();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for(int r = 0; r < m_size; r++)
+  {
+    double sum = 0.0;
+
+    for(int k = rowPointers[r]; k < rowPointers[r + 1]; k++)
+    {
+      sum += values[k] * v[columns[k]];
+    }
+
+    Jv[r] = sum;
+  }
+}
+
+int TransportJacobian::size() const
+{
+  return m_size;
+}
+
+int TransportJacobian::numNonZeros() const
+{
+  return m_columns.size();
+}
+
+int TransportJacobian::numColumnGroups() const
+{
+  return m_groupPointers.empty() ? 0 : m_groupPointers.size() - 1;
+}
+
+const std::vector<int> &TransportJacobian::rowPointers() const
+{
+  return m_rowPointers;
+}
+
+const std::vector<int> &TransportJacobian::columns() const
+{
+  return m_columns;
+}
+
+const std::vector<double> &TransportJacobian::values() const
+{
+  return m_values;
+}
+
+const std::vector<int> &TransportJacobian::diagonal() const
+{
+  return m_diagonal;
+}
+
+int TransportJacobian::find(int row, int column) const
+{
+  const int *begin = m_columns.data() + m_rowPointers[row];
+  const int *end = m_columns.data() + m_rowPointers[row + 1];
+  const int *it = std::lower_bound(begin, end, column);
+
+  return it != end && *it == column ? it - m_columns.data() : -1;
+}
+
+void TransportJacobian::addJunctionRow(const ElementJunction *junction, int row, int variable)
+{
+  //Mirrors ElementJunction::computeDTDt and ElementJunction::computeDSoluteDt. The volume derivative term
+  //uses the junction value at the start of the time step and does not contribute.
+  double diagonal = 0.0;
+
+  for(Element *element : junction->incoming)
+  {
+    int column = variable ? element->sIndex[variable - 1] : element->tIndex;
+    double dispersion = element->longDispersion.value * element->xSectionArea / (element->length / 2.0) / junction->volume;
+
+    m_values[find(row, column)] += element->flow.value / junction->volume + dispersion;
+    diagonal -= dispersion;
+  }
+
+  for(Element *element : junction->outgoing)
+  {
+    int column = variable ? element->sIndex[variable - 1] : element->tIndex;
+    double dispersion = element->longDispersion.value * element->xSectionArea / (element->length / 2.0) / junction->volume;
+
+    m_values[find(row, column)] += -element->flow.value / junction->volume + dispersion;
+    diagonal -= dispersion;
+  }
+
+  m_values[m_diagonal[row]] += diagonal;
+}
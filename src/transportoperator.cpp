@@ -0,0 +1,493 @@
+/*!
+*  \file    transportoperator.cpp
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#include "stdafx.h"
+#include "transportoperator.h"
+#include "elementfluxkernels.h"
+#include "elementstatestore.h"
+#include "element.h"
+#include "elementjunction.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+TransportOperator::TransportOperator()
+  : m_state(nullptr),
+    m_kernels(nullptr),
+    m_numColumns(0),
+    m_numVariables(0),
+    m_assembled(false)
+{
+}
+
+void TransportOperator::initialize(const ElementStateStore *state, const ElementFluxKernels *kernels, const std::vector<Element*> &elements)
+{
+  m_state = state;
+  m_kernels = kernels;
+  m_numVariables = 1 + state->numSolutes;
+  m_assembled = false;
+
+  int numElements = state->numElements;
+
+  m_upstreamJunctionColumn.assign(numElements, -1);
+  m_downstreamJunctionColumn.assign(numElements, -1);
+
+  unordered_map<ElementJunction*, int> junctionColumns;
+  vector<ElementJunction*> junctions;
+
+  for(int i = 0; i < numElements; i++)
+  {
+    ElementJunction *upstreamJunction = elements[i]->upstreamJunction;
+    ElementJunction *downstreamJunction = elements[i]->downstreamJunction;
+
+    auto it = junctionColumns.find(upstreamJunction);
+
+    if(it == junctionColumns.end())
+    {
+      it = junctionColumns.insert({upstreamJunction, numElements + (int)junctions.size()}).first;
+      junctions.push_back(upstreamJunction);
+    }
+
+    m_upstreamJunctionColumn[i] = it->second;
+
+    it = junctionColumns.find(downstreamJunction);
+
+    if(it == junctionColumns.end())
+    {
+      it = junctionColumns.insert({downstreamJunction, numElements + (int)junctions.size()}).first;
+      junctions.push_back(downstreamJunction);
+    }
+
+    m_downstreamJunctionColumn[i] = it->second;
+  }
+
+  m_numColumns = numElements + junctions.size();
+  m_columnIndexes.assign(m_numColumns * m_numVariables, -1);
+
+  for(int i = 0; i < numElements; i++)
+  {
+    m_columnIndexes[i * m_numVariables] = state->tIndex[i];
+
+    for(int j = 0; j < state->numSolutes; j++)
+    {
+      m_columnIndexes[i * m_numVariables + j + 1] = state->sIndex[j][i];
+    }
+  }
+
+  for(size_t k = 0; k < junctions.size(); k++)
+  {
+    int column = numElements + k;
+    m_columnIndexes[column * m_numVariables] = junctions[k]->tIndex;
+
+    for(int j = 0; j < state->numSolutes; j++)
+    {
+      m_columnIndexes[column * m_numVariables + j + 1] = junctions[k]->sIndex[j];
+    }
+  }
+
+  m_rowPointers.assign(numElements + 1, 0);
+  m_heatUpstreamBC.assign(numElements, 0.0);
+  m_heatDownstreamBC.assign(numElements, 0.0);
+  m_soluteUpstreamBC.assign(numElements, 0.0);
+  m_soluteDownstreamBC.assign(numElements, 0.0);
+  m_x.assign(m_numColumns * m_numVariables, 0.0);
+}
+
+bool TransportOperator::assemble()
+{
+  const ElementFluxKernels &kernels = *m_kernels;
+  const ElementStateStore &state = *m_state;
+
+  m_assembled = false;
+
+  //The TVD face fluxes are not linear
+  for(int v = 0; v < std::min(m_numVariables, 2); v++)
+  {
+    for(int slot = 0; slot < 2; slot++)
+    {
+      if(!kernels.m_advectionFaces[ElementFluxKernels::groupIndex(v, slot, ElementFluxKernels::ElementFunction,
+                                                                  ElementFluxKernels::NumAdvectionFluxes)].empty())
+        return false;
+    }
+
+    if(!kernels.m_interiorAdvectionFaces[v * ElementFluxKernels::NumAdvectionFluxes + ElementFluxKernels::ElementFunction].empty())
+      return false;
+  }
+
+  //All solutes share the solute values of the operator
+  for(int v = 2; v < m_numVariables; v++)
+  {
+    for(int slot = 0; slot < 2; slot++)
+    {
+      for(int flux = 0; flux < ElementFluxKernels::NumAdvectionFluxes; flux++)
+      {
+        if(kernels.m_advectionFaces[ElementFluxKernels::groupIndex(v, slot, flux, ElementFluxKernels::NumAdvectionFluxes)] !=
+           kernels.m_advectionFaces[ElementFluxKernels::groupIndex(1, slot, flux, ElementFluxKernels::NumAdvectionFluxes)])
+          return false;
+      }
+
+      for(int flux = 0; flux < ElementFluxKernels::NumDispersionFluxes; flux++)
+      {
+        if(kernels.m_dispersionFaces[ElementFluxKernels::groupIndex(v, slot, flux, ElementFluxKernels::NumDispersionFluxes)] !=
+           kernels.m_dispersionFaces[ElementFluxKernels::groupIndex(1, slot, flux, ElementFluxKernels::NumDispersionFluxes)])
+          return false;
+      }
+    }
+
+    for(int flux = 0; flux < ElementFluxKernels::NumAdvectionFluxes; flux++)
+    {
+      if(kernels.m_interiorAdvectionFaces[v * ElementFluxKernels::NumAdvectionFluxes + flux] !=
+         kernels.m_interiorAdvectionFaces[ElementFluxKernels::NumAdvectionFluxes + flux])
+        return false;
+    }
+  }
+
+  m_triplets.clear();
+  std::fill(m_heatUpstreamBC.begin(), m_heatUpstreamBC.end(), 0.0);
+  std::fill(m_heatDownstreamBC.begin(), m_heatDownstreamBC.end(), 0.0);
+  std::fill(m_soluteUpstreamBC.begin(), m_soluteUpstreamBC.end(), 0.0);
+  std::fill(m_soluteDownstreamBC.begin(), m_soluteDownstreamBC.end(), 0.0);
+
+  for(int v = 0; v < std::min(m_numVariables, 2); v++)
+  {
+    bool heat = v == 0;
+
+    for(int slot = 0; slot < 2; slot++)
+    {
+      for(int flux = 0; flux < ElementFluxKernels::NumAdvectionFluxes; flux++)
+      {
+        for(int i : kernels.m_advectionFaces[ElementFluxKernels::groupIndex(v, slot, flux, ElementFluxKernels::NumAdvectionFluxes)])
+          addFace(flux, true, i, i, 1.0, heat);
+      }
+
+      for(int flux = 0; flux < ElementFluxKernels::NumDispersionFluxes; flux++)
+      {
+        for(int i : kernels.m_dispersionFaces[ElementFluxKernels::groupIndex(v, slot, flux, ElementFluxKernels::NumDispersionFluxes)])
+          addFace(flux, false, i, i, 1.0, heat);
+      }
+    }
+
+    for(int flux = 0; flux < ElementFluxKernels::NumAdvectionFluxes; flux++)
+    {
+      for(int i : kernels.m_interiorAdvectionFaces[v * ElementFluxKernels::NumAdvectionFluxes + flux])
+      {
+        addFace(flux, true, i, i, 1.0, heat);
+        addFace(flux, true, i, state.upstreamElement[i], -1.0, heat);
+      }
+    }
+
+    for(int flux = 0; flux < ElementFluxKernels::NumDispersionFluxes; flux++)
+    {
+      for(int i : kernels.m_interiorDispersionFaces[v * ElementFluxKernels::NumDispersionFluxes + flux])
+      {
+        addFace(flux, false, i, i, 1.0, heat);
+        addFace(flux, false, i, state.upstreamElement[i], -1.0, heat);
+      }
+    }
+  }
+
+  std::sort(m_triplets.begin(), m_triplets.end(), [](const Triplet &a, const Triplet &b)
+  {
+    return a.row < b.row || (a.row == b.row && a.column < b.column);
+  });
+
+  m_columns.clear();
+  m_heatValues.clear();
+  m_soluteValues.clear();
+  std::fill(m_rowPointers.begin(), m_rowPointers.end(), 0);
+
+  for(size_t k = 0; k < m_triplets.size(); k++)
+  {
+    const Triplet &triplet = m_triplets[k];
+
+    if(k && triplet.row == m_triplets[k - 1].row && triplet.column == m_triplets[k - 1].column)
+    {
+      m_heatValues.back() += triplet.heatValue;
+      m_soluteValues.back() += triplet.soluteValue;
+    }
+    else
+    {
+      m_columns.push_back(triplet.column);
+      m_heatValues.push_back(triplet.heatValue);
+      m_soluteValues.push_back(triplet.soluteValue);
+      m_rowPointers[triplet.row + 1]++;
+    }
+  }
+
+  for(int i = 0; i < state.numElements; i++)
+  {
+    m_rowPointers[i + 1] += m_rowPointers[i];
+  }
+
+  m_assembled = true;
+
+  return m_assembled;
+}
+
+bool TransportOperator::isAssembled() const
+{
+  return m_assembled;
+}
+
+void TransportOperator::apply(const std::vector<double> &firstOrderK, const double y[], double dydt[])
+{
+  const ElementStateStore &state = *m_state;
+  const int numVariables = m_numVariables;
+  const int numSolutes = state.numSolutes;
+  const int *columnIndexes = m_columnIndexes.data();
+  double *x = m_x.data();
+
+#ifdef USE_OPENMP
+#pragma omp for
+#endif
+  for(int k = 0; k < m_numColumns * numVariables; k++)
+  {
+    int index = columnIndexes[k];
+    x[k] = index > -1 ? y[index] : 0.0;
+  }
+
+  const int *rowPointers = m_rowPointers.data();
+  const int *columns = m_columns.data();
+  const double *heatValues = m_heatValues.data();
+  const double *soluteValues = m_soluteValues.data();
+
+  vector<double> r(numVariables);
+
+#ifdef USE_OPENMP
+#pragma omp for nowait
+#endif
+  for(int i = 0; i < state.numElements; i++)
+  {
+    std::fill(r.begin(), r.end(), 0.0);
+
+    for(int k = rowPointers[i]; k < rowPointers[i + 1]; k++)
+    {
+      const double *xc = x + columns[k] * numVariables;
+      double soluteValue = soluteValues[k];
+
+      r[0] += heatValues[k] * xc[0];
+
+      for(int v = 1; v < numVariables; v++)
+      {
+        r[v] += soluteValue * xc[v];
+      }
+    }
+
+    int tIndex = state.tIndex[i];
+    double dTdt = 0.0;
+
+    if(state.volume[i] > 1e-12)
+    {
+      dTdt = r[0] + m_heatUpstreamBC[i] * state.upstreamJunctionTemperature[i] +
+             m_heatDownstreamBC[i] * state.downstreamJunctionTemperature[i];
+
+      //External sources, evaporation, convection, fluid friction
+      dTdt += state.heatSources[i];
+
+      //Product rule subtract volume derivative
+      dTdt -= y[tIndex] * state.dvolume_dt[i] / state.volume[i];
+    }
+
+    dydt[tIndex] = dTdt;
+
+    for(int j = 0; j < numSolutes; j++)
+    {
+      int sIndex = state.sIndex[j][i];
+      double dSdt = 0.0;
+
+      if(state.volume[i] > 1e-18)
+      {
+        dSdt = r[j + 1] + m_soluteUpstreamBC[i] * state.upstreamJunctionSoluteConcs[j][i] +
+               m_soluteDownstreamBC[i] * state.downstreamJunctionSoluteConcs[j][i];
+
+        //First order reaction reaction
+        dSdt += firstOrderK[j] * state.soluteConcs[j][i];
+
+        //subtract chain rule volume derivative
+        dSdt -= (y[sIndex] * state.dvolume_dt[i]) / state.sol_volume[i];
+
+        //Add external sources
+        dSdt += state.externalSoluteFluxes[j][i] / state.sol_volume[i];
+      }
+
+      dydt[sIndex] = dSdt;
+    }
+  }
+}
+
+void TransportOperator::addFace(int flux, bool advection, int i, int row, double sign, bool heat)
+{
+  const ElementStateStore &state = *m_state;
+  double scale = 0.0;
+
+  //Same scaling as the element equations: heat terms by rho_cp / rho_cp_vol,
+  //solute advection by sol_volume and solute dispersion by volume.
+  if(heat)
+  {
+    scale = state.volume[row] > 1e-12 ? sign * state.rho_cp[i] / state.rho_cp_vol[row] : 0.0;
+  }
+  else if(state.volume[row] > 1e-18)
+  {
+    scale = sign / (advection ? state.sol_volume[row] : state.volume[row]);
+  }
+
+  if(scale == 0.0)
+    return;
+
+  double *upstreamBC = heat ? m_heatUpstreamBC.data() : m_soluteUpstreamBC.data();
+  double *downstreamBC = heat ? m_heatDownstreamBC.data() : m_soluteDownstreamBC.data();
+
+  if(advection)
+  {
+    switch(flux)
+    {
+      case ElementFluxKernels::UpwindInFluxUpJunction:
+        addEntry(row, m_upstreamJunctionColumn[i], scale * state.flow[i], heat);
+        break;
+      case ElementFluxKernels::UpwindInFluxUpJunctionBC:
+        upstreamBC[row] += scale * state.flow[i];
+        break;
+      case ElementFluxKernels::UpwindInFluxUpNeighbour:
+        addEntry(row, state.upstreamElement[i], scale * state.flow[state.upstreamElement[i]], heat);
+        break;
+      case ElementFluxKernels::UpwindInFluxSelf:
+        addEntry(row, i, scale * state.flow[i], heat);
+        break;
+      case ElementFluxKernels::UpwindOutFluxSelf:
+        addEntry(row, i, -scale * state.flow[i], heat);
+        break;
+      case ElementFluxKernels::UpwindOutFluxDownJunction:
+        addEntry(row, m_downstreamJunctionColumn[i], -scale * state.flow[i], heat);
+        break;
+      case ElementFluxKernels::UpwindOutFluxDownJunctionBC:
+        downstreamBC[row] -= scale * state.flow[i];
+        break;
+      case ElementFluxKernels::UpwindOutFluxDownNeighbour:
+        addEntry(row, state.downstreamElement[i], -scale * state.flow[state.downstreamElement[i]], heat);
+        break;
+      case ElementFluxKernels::CentralFluxUpNeighbour:
+        {
+          int up = state.upstreamElement[i];
+          double centerFactor = state.upstreamCenterWeight[i];
+          double upstreamFactor = state.upstreamNeighbourWeight[i];
+
+          addEntry(row, up, scale * state.flow[up] * upstreamFactor, heat);
+          addEntry(row, i, scale * state.flow[i] * centerFactor, heat);
+        }
+        break;
+      case ElementFluxKernels::CentralFluxDownNeighbour:
+        {
+          int down = state.downstreamElement[i];
+          double centerFactor = state.downstreamCenterWeight[i];
+          double downstreamFactor = state.downstreamNeighbourWeight[i];
+
+          addEntry(row, down, -scale * state.flow[down] * downstreamFactor, heat);
+          addEntry(row, i, -scale * state.flow[i] * centerFactor, heat);
+        }
+        break;
+      case ElementFluxKernels::HybridFluxUpNeighbour:
+        {
+          int up = state.upstreamElement[i];
+          double upstreamFactor = state.upstreamNeighbourWeight[i];
+          double centerFactor = state.upstreamCenterWeight[i];
+
+          upstreamFactor = (1 + (1.0 / state.upstreamPecletNumber[i] / upstreamFactor)) * upstreamFactor;
+          centerFactor = (1 - (1.0 / state.upstreamPecletNumber[i] / centerFactor)) * centerFactor;
+
+          addEntry(row, up, scale * state.flow[up] * upstreamFactor, heat);
+          addEntry(row, i, scale * state.flow[i] * centerFactor, heat);
+        }
+        break;
+      case ElementFluxKernels::HybridFluxDownNeighbour:
+        {
+          int down = state.downstreamElement[i];
+          double downstreamFactor = state.downstreamNeighbourWeight[i];
+          double centerFactor = state.downstreamCenterWeight[i];
+
+          centerFactor = (1 + (1.0 / state.downstreamPecletNumber[i] / centerFactor)) * centerFactor;
+          downstreamFactor = (1 - (1.0 / state.downstreamPecletNumber[i] / downstreamFactor)) * downstreamFactor;
+
+          addEntry(row, i, -scale * state.flow[i] * centerFactor, heat);
+          addEntry(row, down, -scale * state.flow[down] * downstreamFactor, heat);
+        }
+        break;
+    }
+  }
+  else
+  {
+    switch(flux)
+    {
+      case ElementFluxKernels::DispersionUpJunction:
+        {
+          double k = scale * state.upstreamLongDispersion[i] * state.upstreamXSectionArea[i] * state.inverseHalfLength[i];
+          addEntry(row, m_upstreamJunctionColumn[i], k, heat);
+          addEntry(row, i, -k, heat);
+        }
+        break;
+      case ElementFluxKernels::DispersionUpJunctionBC:
+        {
+          double k = scale * state.upstreamLongDispersion[i] * state.upstreamXSectionArea[i] * state.inverseHalfLength[i];
+          upstreamBC[row] += k;
+          addEntry(row, i, -k, heat);
+        }
+        break;
+      case ElementFluxKernels::DispersionUpNeighbour:
+        {
+          int up = state.upstreamElement[i];
+          double k = scale * state.upstreamLongDispersion[i] * state.upstreamXSectionArea[i] * state.upstreamInverseDistance[i];
+          addEntry(row, up, k, heat);
+          addEntry(row, i, -k, heat);
+        }
+        break;
+      case ElementFluxKernels::DispersionDownJunction:
+        {
+          double k = scale * state.downstreamLongDispersion[i] * state.downstreamXSectionArea[i] * state.inverseHalfLength[i];
+          addEntry(row, m_downstreamJunctionColumn[i], k, heat);
+          addEntry(row, i, -k, heat);
+        }
+        break;
+      case ElementFluxKernels::DispersionDownJunctionBC:
+        {
+          double k = scale * state.downstreamLongDispersion[i] * state.downstreamXSectionArea[i] * state.inverseHalfLength[i];
+          downstreamBC[row] += k;
+          addEntry(row, i, -k, heat);
+        }
+        break;
+      case ElementFluxKernels::DispersionDownNeighbour:
+        {
+          int down = state.downstreamElement[i];
+          double k = scale * state.downstreamLongDispersion[i] * state.downstreamXSectionArea[i] * state.downstreamInverseDistance[i];
+          addEntry(row, down, k, heat);
+          addEntry(row, i, -k, heat);
+        }
+        break;
+    }
+  }
+}
+
+void TransportOperator::addEntry(int row, int column, double value, bool heat)
+{
+  m_triplets.push_back({row, column, heat ? value : 0.0, heat ? 0.0 : value});
+}
@@ -0,0 +1,190 @@
+/*!
+*  \file    treelinearsolver.cpp
+*  \author  Caleb Amoa Buahin <caleb.buahin@gmail.com>
+*  \version 1.0.0
+*  \section Description
+*  This file and its associated files and libraries are free software;
+*  you can redistribute it and/or modify it under the terms of the
+*  Lesser GNU Lesser General Public License as published by the Free Software Foundation;
+*  either version 3 of the License, or (at your option) any later version.
+*  fvhmcompopnent.h its associated files is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.(see <http://www.gnu.org/licenses/> for details)
+*  \date 2018
+*  \pre
+*  \bug
+*  \todo
+*  \warning
+*/
+
+#include "stdafx.h"
+#include "treelinearsolver.h"
+#include "transportjacobian.h"
+
+#include <algorithm>
+
+using namespace std;
+
+TreeLinearSolver::TreeLinearSolver()
+  : m_jacobian(nullptr),
+    m_isTree(false)
+{
+}
+
+bool TreeLinearSolver::initialize(const TransportJacobian *jacobian)
+{
+  m_jacobian = jacobian;
+  m_isTree = false;
+
+  int size = jacobian->size();
+  const vector<int> &rowPointers = jacobian->rowPointers();
+  const vector<int> &columns = jacobian->columns();
+
+  //Undirected adjacency of the pattern
+  vector<vector<int>> neighbours(size);
+
+  for(int r = 0; r < size; r++)
+  {
+    for(int k = rowPointers[r]; k < rowPointers[r + 1]; k++)
+    {
+      int c = columns[k];
+
+      if(c != r)
+      {
+        neighbours[r].push_back(c);
+        neighbours[c].push_back(r);
+      }
+    }
+  }
+
+  for(vector<int> &adjacent : neighbours)
+  {
+    std::sort(adjacent.begin(), adjacent.end());
+    adjacent.erase(std::unique(adjacent.begin(), adjacent.end()), adjacent.end());
+  }
+
+  //Breadth first ordering from a root in each component. Any edge that does not lead to
+  //the parent or an unvisited child closes a loop.
+  m_order.clear();
+  m_parent.assign(size, -1);
+  vector<bool> visited(size, false);
+
+  for(int root = 0; root < size; root++)
+  {
+    if(visited[root])
+      continue;
+
+    visited[root] = true;
+    size_t head = m_order.size();
+    m_order.push_back(root);
+
+    while(head < m_order.size())
+    {
+      int node = m_order[head++];
+
+      for(int neighbour : neighbours[node])
+      {
+        if(neighbour == m_parent[node])
+          continue;
+
+        if(visited[neighbour])
+          return false;
+
+        visited[neighbour] = true;
+        m_parent[neighbour] = node;
+        m_order.push_back(neighbour);
+      }
+    }
+  }
+
+  m_toParentPosition.assign(size, -1);
+  m_fromParentPosition.assign(size, -1);
+
+  for(int r = 0; r < size; r++)
+  {
+    for(int k = rowPointers[r]; k < rowPointers[r + 1]; k++)
+    {
+      int c = columns[k];
+
+      if(c == m_parent[r])
+        m_toParentPosition[r] = k;
+      else if(c != r && m_parent[c] == r)
+        m_fromParentPosition[c] = k;
+    }
+  }
+
+  m_pivots.assign(size, 1.0);
+  m_toParent.assign(size, 0.0);
+  m_fromParent.assign(size, 0.0);
+  m_work.assign(size, 0.0);
+
+  m_isTree = true;
+
+  return m_isTree;
+}
+
+bool TreeLinearSolver::isTree() const
+{
+  return m_isTree;
+}
+
+bool TreeLinearSolver::factorize(double gamma)
+{
+  const vector<double> &values = m_jacobian->values();
+  const vector<int> &diagonal = m_jacobian->diagonal();
+  int size = m_order.size();
+
+  for(int i = 0; i < size; i++)
+  {
+    m_pivots[i] = 1.0 - gamma * values[diagonal[i]];
+    m_toParent[i] = m_toParentPosition[i] > -1 ? -gamma * values[m_toParentPosition[i]] : 0.0;
+    m_fromParent[i] = m_fromParentPosition[i] > -1 ? -gamma * values[m_fromParentPosition[i]] : 0.0;
+  }
+
+  //Leaves to roots
+  for(int k = size - 1; k >= 0; k--)
+  {
+    int i = m_order[k];
+
+    if(m_pivots[i] == 0.0)
+      return false;
+
+    int p = m_parent[i];
+
+    if(p > -1)
+    {
+      m_pivots[p] -= m_fromParent[i] * m_toParent[i] / m_pivots[i];
+    }
+  }
+
+  return true;
+}
+
+void TreeLinearSolver::solve(const double r[], double z[])
+{
+  int size = m_order.size();
+  double *work = m_work.data();
+
+  std::copy(r, r + size, work);
+
+  //Leaves to roots
+  for(int k = size - 1; k >= 0; k--)
+  {
+    int i = m_order[k];
+    int p = m_parent[i];
+
+    if(p > -1)
+    {
+      work[p] -= m_fromParent[i] * work[i] / m_pivots[i];
+    }
+  }
+
+  //Roots to leaves
+  for(int k = 0; k < size; k++)
+  {
+    int i = m_order[k];
+    int p = m_parent[i];
+
+    z[i] = p > -1 ? (work[i] - m_toParent[i] * z[p]) / m_pivots[i] : work[i] / m_pivots[i];
+  }
+}